@@ -0,0 +1,67 @@
+/*
+ * @path include/octree/arena.hpp
+ * @file arena.hpp
+*/
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <algorithm>
+#include <vector>
+
+// Bump allocator handing out 32-bit indices into one contiguous block. The block is kept
+// between frames and sized from the high-water mark of the previous frame, so once the
+// simulation reaches a steady state building a tree does not touch the heap.
+template <typename T>
+class Arena {
+    public:
+        // Release every element in O(1), the storage is kept for the next frame
+        void reset() {
+            high_water = std::max(high_water, used);
+            used = 0;
+            if (storage.size() < high_water + high_water / 8) {
+                storage.resize(high_water + high_water / 8);
+            }
+        }
+
+        // Index of the first of count consecutive elements
+        u_int allocate(u_int count) {
+            const u_int first = used;
+            used += count;
+            if (storage.size() < used) {
+                storage.resize(used + used / 2);
+            }
+            return first;
+        }
+
+        [[nodiscard]] u_int size() const {
+            return used;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return used == 0;
+        }
+
+        T& operator[](u_int index) {
+            return storage[index];
+        }
+
+        const T& operator[](u_int index) const {
+            return storage[index];
+        }
+
+        [[nodiscard]] const T* begin() const {
+            return storage.data();
+        }
+
+        [[nodiscard]] const T* end() const {
+            return storage.data() + used;
+        }
+
+    private:
+        std::vector<T> storage;
+        u_int used = 0;
+        u_int high_water = 0;
+};
+
+#endif // ARENA_HPP
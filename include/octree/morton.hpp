@@ -0,0 +1,52 @@
+/*
+ * @path include/octree/morton.hpp
+ * @file morton.hpp
+*/
+
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../simulation/bound.hpp"
+
+// Keys of the octree (DIMENSION 3) or of the quadtree of planar runs (DIMENSION 2), which
+// ignores z. A level of the key takes DIMENSION bits, x the lowest of them.
+class Morton {
+    public:
+        // Bits per axis, 3 * 21 = 63 or 2 * 24 = 48 bit keys. The positions are floats, finer
+        // cells than their 24 bit mantissa would only split rounding noise.
+        template <u_int DIMENSION>
+        static constexpr u_int BITS = DIMENSION == 2 ? 24 : 21;
+        template <u_int DIMENSION>
+        static constexpr u_int CHILDREN = 1u << DIMENSION;
+        // Deepest level of a tree of any dimension
+        static constexpr u_int LEVELS = BITS<2>;
+
+        template <u_int DIMENSION>
+        static uint64_t encode(const glm::vec3& position, const Bound& bound);
+        // Child of the node at the given depth holding the key
+        template <u_int DIMENSION>
+        [[nodiscard]] static u_int child(uint64_t key, u_int depth);
+
+        static constexpr u_int RADIX_BITS = 8;
+        static constexpr size_t BUCKETS = size_t(1) << RADIX_BITS;
+
+        // Scratch space of the sort, kept by the caller between frames
+        struct SortBuffer {
+            std::vector<uint64_t> keys;
+            std::vector<u_int> indices;
+            std::vector<std::array<size_t, BUCKETS>> histograms;
+        };
+
+        // Sort the keys in ascending order carrying the indices along (LSD radix sort)
+        static void sort(std::vector<uint64_t>& keys, std::vector<u_int>& indices, SortBuffer& buffer);
+
+    private:
+        template <u_int DIMENSION>
+        static uint64_t expand_bits(uint64_t value);
+};
+
+#endif // MORTON_HPP
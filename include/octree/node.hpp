@@ -6,40 +6,60 @@
 #ifndef NODE_HPP
 #define NODE_HPP
 
-#include <array>
-#include <vector>
-#include <memory>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "../simulation/bound.hpp"
-#include "../simulation/body.hpp"
 
+// Node of the linear octree, children are stored contiguously in the tree node array
+// and the bodies of a node are a contiguous range of the Morton sorted body order.
+// Links are 32-bit indices, a node takes 48 bytes.
 struct Node {
-    public:
-        explicit Node(Bound bound, int depth);
+    Bound bound;
 
-        Node(const Node& node) = delete;
-        Node(Node&& node) noexcept = delete;
-        Node& operator=(const Node& node) = delete;
-        Node& operator=(Node&& node) noexcept = delete;
+    glm::vec3 center_of_mass;
+    float total_mass;
 
-        ~Node();
+    u_int first_child;
+    u_int first_body;
+    u_int body_count;
+    uint8_t child_count;
+    uint8_t depth;
 
-        bool insert(Body* body);
-        void subdivide();
-        void calculate_center_of_mass();
-        void calculate_force(Body& body, float theta, float gravity, const double softening_factor) const;
+    Node() : Node(Bound(), 0, 0, 0) {}
 
-    private:
-        std::array<Node*, 8> children;
-        std::vector<Body*> bodies;
-        const Bound bound;
-        bool is_leaf;
-        u_int depth;
+    Node(Bound bound, u_int first_body, u_int body_count, u_int depth) :
+        bound(bound),
+        center_of_mass(0.0f),
+        total_mass(0.0f),
+        first_child(0),
+        first_body(first_body),
+        body_count(body_count),
+        child_count(0),
+        depth(static_cast<uint8_t>(depth)) {}
 
-        glm::vec3 center_of_mass;
-        float total_mass;
+    [[nodiscard]] bool is_leaf() const {
+        return child_count == 0;
+    }
+};
+
+// Compact copy of a node holding only what the force walk reads, 48 bytes so that the walk
+// never touches the nodes. The array is threaded: opening a node continues with its first
+// child, accepting or finishing it continues with next, the end of the walk is next == 0.
+struct TraversalNode {
+    glm::vec3 center_of_mass;
+    float total_mass;
+
+    // Squared cell size, a node is accepted when size_squared < theta^2 * distance^2
+    float size_squared;
+    u_int next;
+    // First child of an inner node, first body of a leaf
+    u_int first;
+    // Zero for inner nodes
+    u_int body_count;
 
-        friend class Tree;
+    // Cell box as built or refitted, it holds every body of the cell
+    glm::vec3 cell_center;
+    float half_width;
 };
 
 #endif // NODE_HPP
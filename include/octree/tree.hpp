@@ -6,19 +6,172 @@
 #ifndef TREE_HPP
 #define TREE_HPP
 
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include "node.hpp"
+#include "arena.hpp"
+#include "morton.hpp"
+#include "../simulation/body_store.hpp"
+#include "../simulation/kernel.hpp"
 
 class Tree {
     public:
-        explicit Tree(Bound bound);
+        static constexpr u_int DEFAULT_LEAF_CAPACITY = 16;
+        // Refitted leaves may grow by this factor in total before the tree is rebuilt
+        static constexpr float REFIT_QUALITY = 1.5f;
+        // A body counts as having left its leaf once it is this many cell half widths outside
+        static constexpr float REFIT_SLACK = 0.5f;
+        // Bodies of the largest groups of the walks with a split scale
+        static constexpr u_int SPLIT_GROUP_CAPACITY = 256;
+        // Returned by find_nearest when no body is in range
+        static constexpr u_int NO_BODY = std::numeric_limits<u_int>::max();
 
-        void insert(Body* body);
-        void calculate_center_of_mass();
-        void calculate_force(Body& body, float theta, float gravity, const double softening_factor) const;
+        // Multipole acceptance criteria, distances are taken from the closest point of the walked group
+        enum class Opening {
+            // size / distance to the center of mass < theta
+            GEOMETRIC,
+            // Salmon-Warren, bmax / distance to the center of mass < theta with bmax the distance
+            // from the center of mass to the farthest corner of the cell
+            BMAX,
+            // size / distance to the cell box < theta, a cell is never accepted by its own bodies
+            BOX,
+            // GADGET style, mass * size^2 / distance^4 < accuracy * |a| of the previous step, the
+            // cell box grown by a fifth is always opened. Geometric while there is no previous |a|.
+            RELATIVE
+        };
+
+        // Bodies walked as one group and the bodies of the leaves their walk opened
+        struct Neighborhood {
+            std::vector<u_int> members;
+            std::vector<u_int> neighbors;
+        };
+
+        Tree() = default;
+
+        // Octree, or with dimension 2 a quadtree splitting in x and y only for bodies in a plane
+        // of constant z. The cells stay cubes, the children of a quadtree node keep its center z.
+        void build(const BodyStore& bodies, size_t count, const Bound& bound, u_int leaf_capacity = DEFAULT_LEAF_CAPACITY, u_int dimension = 3);
+        // Keep the topology of the last build and move the bodies to their current positions,
+        // the node bounds are refitted bottom-up. Returns false when a body left the cell of its
+        // leaf (by more than REFIT_SLACK) or the refitted leaves degraded past REFIT_QUALITY,
+        // the tree must be rebuilt then.
+        [[nodiscard]] bool refit(const BodyStore& bodies);
+        // Cube in which a long range solver holds the sources, set before the centers of mass.
+        // With a split scale only the bodies inside it interact with the short range kernel,
+        // any pair with a body outside it with the full kernel. Null, the default, is unbounded.
+        void set_long_range_region(const Bound* region);
+        // Centers of mass of the cells and, up to the given degree (2 quadrupole, 3 octupole),
+        // their higher moments, which the walk then adds to the monopole of the accepted cells
+        void calculate_center_of_mass(int multipole_degree = 0);
+        // Mass weighted velocities of the cells, called after calculate_center_of_mass. The walks
+        // without a split scale then also compute the jerk, from the monopoles of the cells.
+        void calculate_velocities(const BodyStore& bodies);
+        // With a split scale only the short range force is computed, cells beyond the cutoff of
+        // the kernel are skipped without being opened
+        [[nodiscard]] glm::vec3 calculate_force(const BodyStore& bodies, size_t index, InteractionList& interactions, float theta, float gravity, float softening_factor, float split = 0.0f, Opening opening = Opening::GEOMETRIC, float accuracy = 0.0f, glm::vec3* jerk = nullptr);
+        // Grouped walk: the tree is walked once per leaf and the resulting interaction list is
+        // shared by all bodies of the leaf. Writes the acceleration of every body in the tree.
+        // With a split scale the short lists leave the walk itself as the cost, the groups are then
+        // the nodes of up to SPLIT_GROUP_CAPACITY bodies. A group reaching out of the long range
+        // region is walked body by body.
+        void calculate_group_forces(BodyStore& bodies, std::vector<InteractionList>& interactions, float theta, float gravity, float softening_factor, float split = 0.0f, Opening opening = Opening::GEOMETRIC, float accuracy = 0.0f);
+
+        // Grouped walk of the bodies from first to last, which are not in the tree: they are sorted
+        // along the Morton curve and walked in runs of the leaf capacity, every run sharing one
+        // interaction list. Without the jerk.
+        void calculate_outside_forces(BodyStore& bodies, size_t first, size_t last, std::vector<InteractionList>& interactions, float theta, float gravity, float softening_factor, float split = 0.0f, Opening opening = Opening::GEOMETRIC, float accuracy = 0.0f);
+
+        // Index of the body of the tree closest to the position within the radius, other than
+        // the excluded one, or NO_BODY. Cells farther than the closest body so far are skipped.
+        [[nodiscard]] u_int find_nearest(const glm::vec3& position, u_int excluded, float radius) const;
+        // Bodies of the tree within the radius of every leaf, by body index. Bodies outside the
+        // tree, up to count, are groups of their own.
+        void collect_neighborhoods(const BodyStore& bodies, size_t count, std::vector<InteractionList>& interactions, std::vector<Neighborhood>& neighborhoods, float radius) const;
+
+        [[nodiscard]] const Arena<Node>& get_nodes() const;
+        [[nodiscard]] const std::vector<u_int>& get_levels() const;
+        [[nodiscard]] const std::vector<u_int>& get_indices() const;
+        [[nodiscard]] const std::array<aligned_vector<float>, 3>& get_positions() const;
+        [[nodiscard]] const aligned_vector<float>& get_masses() const;
+        [[nodiscard]] size_t get_body_count() const;
+        [[nodiscard]] u_int get_dimension() const;
 
     private:
-        Node root;
+        u_int leaf_capacity = DEFAULT_LEAF_CAPACITY;
+        u_int dimension = 3;
+
+        // Reused by every build, only grows when the tree outgrows the previous frames
+        Arena<Node> nodes;
+        std::vector<TraversalNode> traversal;
+        std::vector<u_int> leaves;
+        std::vector<u_int> split_groups;
+
+        // Morton keys and body indices in sorted order
+        std::vector<uint64_t> keys;
+        std::vector<u_int> indices;
+        Morton::SortBuffer sort_buffer;
+        // Keys and body indices of the bodies walked outside the tree
+        std::vector<uint64_t> outside_keys;
+        std::vector<u_int> outside_indices;
+
+        // Copies of the inserted bodies in sorted order so that leaves are contiguous
+        std::array<aligned_vector<float>, 3> positions;
+        aligned_vector<float> masses;
+
+        // Second and third moments of every node about its center of mass, sized by the degree
+        int multipole_degree = 0;
+        std::vector<std::array<float, 6>> quadrupoles;
+        std::vector<std::array<float, 10>> octupoles;
+
+        // Long range region of the split walks, whether any source lies outside it, the mass of
+        // every cell outside it and its center, and one list per thread of the sources summed with
+        // the full kernel
+        bool regional = false;
+        bool outlying = false;
+        Bound long_range_region;
+        std::vector<glm::vec3> outside_centers;
+        std::vector<float> outside_masses;
+        std::vector<InteractionList> unsplit;
+
+        // Velocities of the inserted bodies in sorted order and of the cells, for the jerk
+        bool with_jerk = false;
+        std::array<aligned_vector<float>, 3> velocities;
+        std::vector<glm::vec3> cell_velocities;
+
+        // Node index at which every level of the tree starts, plus the end of the last level
+        std::vector<u_int> levels;
+
+        // Cells of the nodes as built, refitting moves the node bounds but not these
+        std::vector<Bound> cells;
+        float built_leaf_width = 0.0f;
+
+        // Scratch space of the level being split, the key ranges of up to eight children
+        std::vector<std::array<u_int, 9>> splits;
+        std::vector<u_int> child_offsets;
+
+        [[nodiscard]] uint64_t encode(const glm::vec3& position, const Bound& bound) const;
+        void gather(const BodyStore& bodies);
+        // Splits the levels breadth first until every leaf is small enough
+        template <u_int DIMENSION>
+        void build_levels();
+        template <u_int DIMENSION>
+        u_int split(const Node& node, std::array<u_int, 9>& octants) const;
+        template <u_int DIMENSION>
+        void subdivide(u_int index, const std::array<u_int, 9>& octants, u_int first_child, u_int child_count);
+        void thread_traversal();
+        void calculate_moments(u_int index);
+        // The relative criterion accepts a cell when mass * size^2 < threshold * distance^4. With
+        // an unsplit list the cells and bodies outside the long range region go there, uncut.
+        void collect_interactions(const glm::vec3& lower, const glm::vec3& upper, InteractionList& interactions, float theta, float cutoff, Opening opening, float threshold, InteractionList* outside = nullptr) const;
+        // Collects the lists of a group for the split scale and returns the scale to evaluate them
+        // with, zero for a group outside the long range region. Sets outside to the unsplit list.
+        float collect_split_interactions(const glm::vec3& lower, const glm::vec3& upper, InteractionList& interactions, InteractionList*& outside, float theta, float split, float softening_squared, Opening opening, float threshold);
+        // Whether the group box crosses a face of the long range region of a split walk
+        [[nodiscard]] bool straddles(const glm::vec3& lower, const glm::vec3& upper, float split) const;
+        [[nodiscard]] glm::vec3 evaluate(const glm::vec3& position, const InteractionList& interactions, float softening_squared, float split, const InteractionList* outside = nullptr) const;
+        [[nodiscard]] Kernel::Derivatives evaluate_jerk(const glm::vec3& position, const glm::vec3& velocity, const InteractionList& interactions, float softening_squared) const;
 };
 
 #endif // TREE_HPP
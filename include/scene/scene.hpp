@@ -9,11 +9,26 @@
 #include "camera.hpp"
 #include "simulation/n_body.hpp"
 #include "simulation/barnes_hut.hpp"
+#include "simulation/fmm.hpp"
+#include "simulation/direct_sum.hpp"
+#include "simulation/particle_mesh.hpp"
+#include "simulation/tree_pm.hpp"
+#include "simulation/planetary.hpp"
 
 class Scene {
     public:
+        enum class Solver {
+            BARNES_HUT,
+            FMM,
+            DIRECT_SUM,
+            PARTICLE_MESH,
+            TREE_PM,
+            PLANETARY
+        };
+
         Camera camera;
         NBody* n_body = nullptr;
+        Solver solver = Solver::BARNES_HUT;
 
         Scene(int width, int height);
         void update(float delta_time);
@@ -27,6 +42,9 @@ class Scene {
 
         void simulate();
 
+        // The caller owns the returned simulation
+        [[nodiscard]] static NBody* create(Solver solver, int body_count);
+
     private:
         bool paused = false;
 };
@@ -0,0 +1,50 @@
+/*
+ * @path include/simulation/aligned_allocator.hpp
+ * @file aligned_allocator.hpp
+*/
+
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Allocator returning cache line aligned storage, wide enough for any SIMD load
+template <typename T, std::size_t ALIGNMENT = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, ALIGNMENT>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    explicit AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>& /*other*/) noexcept {}
+
+    T* allocate(std::size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT)));
+    }
+
+    void deallocate(T* pointer, std::size_t /*count*/) noexcept {
+        ::operator delete(pointer, std::align_val_t(ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, ALIGNMENT>& /*other*/) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, ALIGNMENT>& /*other*/) const noexcept {
+        return false;
+    }
+};
+
+template <typename T>
+using aligned_vector = std::vector<T, AlignedAllocator<T>>;
+
+#endif // ALIGNED_ALLOCATOR_HPP
@@ -7,38 +7,48 @@
 #define BARNES_HUT_HPP
 
 #include<vector>
-#include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "../octree/tree.hpp"
+#include "../simulation/body_store.hpp"
 #include "../simulation/n_body.hpp"
 
 
 class BarnesHut : public NBody {
     public:
+        // Multiple time stepping: neighbor lists reach this far past the cutoff of the near field
+        static constexpr float NEIGHBOR_REACH = 1.2f;
+
         explicit BarnesHut(int bodies_count = 10000);
         BarnesHut(const BarnesHut&) = delete;
         BarnesHut(BarnesHut&&) = delete;
         BarnesHut& operator=(const BarnesHut&) = delete;
         BarnesHut& operator=(BarnesHut&&) = delete;
-        ~BarnesHut() override;
-
-        void update(const float& delta_time) final;
-        void render(glm::mat4 view, glm::mat4 view_projection) final;
-        void reset() final;
-        void clear();
-        void randomize();
+        ~BarnesHut() override = default;
 
-        [[nodiscard]] size_t get_body_count() const final;
-        void set_body_count(const size_t& body_count) final;
+        [[nodiscard]] bool has_active_forces() const override;
 
-    private:
-        std::vector<Body> bodies;
+    protected:
+        void calculate_forces() override;
+        void calculate_active_forces(const std::vector<u_int>& active) override;
+        // Mutual nearest neighbors from the octree of the last force pass
+        void find_close_pairs(float radius, std::vector<Encounter>& pairs) override;
+        // The near field is the erfc weighted short range part of the pairs closer than the
+        // cutoff at near_field_scale, summed over neighbor lists, the far field the rest of the walk
+        void calculate_far_forces(std::array<aligned_vector<float>, 3>& far) override;
+        void calculate_near_forces() override;
 
-        static const char* const vertex_shader;
-        static const char* const fragment_shader;
+        // Accelerations of every body, or of the active ones only, from the tree walk. With a
+        // split scale only the short range part, of the pairs within the region if one is given.
+        void calculate_tree_forces(float split = 0.0f, const std::vector<u_int>* active = nullptr, const Bound* region = nullptr);
 
-        Shader shader;
-        GLuint vao, vbo;
+    private:
+        // Kept between steps so that the steady-state loop does not allocate
+        Tree octree;
+        Bound bound = Bound(glm::vec3(0.0f), 10.0f);
+        int steps_since_build = 0;
+        std::vector<InteractionList> interactions;
+        std::vector<u_int> nearest;
+        std::vector<Tree::Neighborhood> neighborhoods;
 };
 
-#endif // BARNES_HUT_HPP
\ No newline at end of file
+#endif // BARNES_HUT_HPP
@@ -0,0 +1,36 @@
+/*
+ * @path include/simulation/body_store.hpp
+ * @file body_store.hpp
+*/
+
+#ifndef BODY_STORE_HPP
+#define BODY_STORE_HPP
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+#include "aligned_allocator.hpp"
+
+// Structure of arrays holding every body of a simulation. The hot state streamed by the
+// octree and the integrator is kept in one aligned array per component, the cold data
+// only needed for rendering lives in separate arrays.
+struct BodyStore {
+    std::array<aligned_vector<float>, 3> position;
+    std::array<aligned_vector<float>, 3> velocity;
+    std::array<aligned_vector<float>, 3> acceleration;
+    // Time derivative of the acceleration, only computed for the Hermite integrator
+    std::array<aligned_vector<float>, 3> jerk;
+    aligned_vector<float> mass;
+
+    std::vector<glm::vec3> color;
+    std::vector<u_int> id;
+
+    void resize(size_t count);
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] glm::vec3 get_position(size_t index) const;
+    [[nodiscard]] glm::vec3 get_velocity(size_t index) const;
+};
+
+#endif // BODY_STORE_HPP
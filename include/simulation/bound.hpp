@@ -7,15 +7,25 @@
 #define BOUND_HPP
 
 #include <glm/glm.hpp>
-#include "body.hpp"
+#include "body_store.hpp"
 
 struct Bound {
-    const glm::vec3 center;
-    const float half_width;
+    glm::vec3 center;
+    float half_width;
 
+    Bound();
     Bound(glm::vec3 center, float half_width);
 
-    [[nodiscard]] bool contains(const Body& body) const;
+    [[nodiscard]] bool contains(const glm::vec3& position) const;
+    [[nodiscard]] bool contains(const Bound& other) const;
+
+    // Smallest cube holding the first count bodies
+    [[nodiscard]] static Bound enclosing(const BodyStore& bodies, size_t count);
+
+    // Bound to use for the next step given the one of the previous step. The previous bound is
+    // kept while it still holds every body and is at most (1 + hysteresis)^2 times too large,
+    // otherwise the fitted bound grown by the hysteresis is used, so the box does not jitter.
+    [[nodiscard]] Bound follow(const Bound& fitted, float hysteresis) const;
 };
 
-#endif // BOUND_HPP
\ No newline at end of file
+#endif // BOUND_HPP
@@ -0,0 +1,47 @@
+/*
+ * @path include/simulation/direct_sum.hpp
+ * @file direct_sum.hpp
+*/
+
+#ifndef DIRECT_SUM_HPP
+#define DIRECT_SUM_HPP
+
+#include <array>
+#include <utility>
+#include <vector>
+#include "../simulation/aligned_allocator.hpp"
+#include "../simulation/n_body.hpp"
+
+// Exact O(N^2) summation over all pairs, the fastest solver for small systems and the reference
+// the approximate solvers are checked against
+class DirectSum : public NBody {
+    public:
+        // Targets of one task and sources of one tile, a tile stays in L1 while the block uses it
+        static constexpr size_t BLOCK = 64;
+        static constexpr size_t TILE = 1024;
+
+        explicit DirectSum(int bodies_count = 10000);
+        DirectSum(const DirectSum&) = delete;
+        DirectSum(DirectSum&&) = delete;
+        DirectSum& operator=(const DirectSum&) = delete;
+        DirectSum& operator=(DirectSum&&) = delete;
+        ~DirectSum() override = default;
+
+        [[nodiscard]] bool has_active_forces() const final;
+
+    protected:
+        void calculate_forces() final;
+        // Only the active bodies are summed, against every source
+        void calculate_active_forces(const std::vector<u_int>& active) final;
+
+    private:
+        // Accelerations of every thread when pairs are evaluated once for both bodies
+        std::vector<std::array<aligned_vector<float>, 3>> thread_accelerations;
+        std::vector<std::pair<size_t, size_t>> tiles;
+
+        // Targets begin to end, the bodies at those places of the active list when one is given
+        void evaluate(size_t begin, size_t end, size_t sources, float softening_squared, const std::vector<u_int>* active = nullptr);
+        void evaluate_symmetric(size_t sources, float softening_squared);
+};
+
+#endif // DIRECT_SUM_HPP
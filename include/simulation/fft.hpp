@@ -0,0 +1,51 @@
+/*
+ * @path include/simulation/fft.hpp
+ * @file fft.hpp
+*/
+
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include <complex>
+#include <vector>
+#include "aligned_allocator.hpp"
+
+// Radix-2 fast Fourier transform of a cube whose side is a power of two, from real values to
+// the half spectrum of the last axis and back. Lines are transformed a block at a time with
+// the real and imaginary parts split, so every butterfly is one SIMD operation over the block.
+class FFT {
+    public:
+        using Complex = std::complex<float>;
+
+        // Lines transformed together, one per SIMD lane
+        static constexpr size_t BLOCK = 8;
+
+        void prepare(size_t size);
+
+        // Real values at [x][y][z] to coefficients at [x][y][k] with k <= size / 2. Only the
+        // first extent values along every axis may be non zero, the other lines are skipped.
+        void forward(const float* real, Complex* spectrum, size_t extent);
+        // Inverse of forward, normalized, only the first extent values along every axis are computed
+        void inverse(Complex* spectrum, float* real, size_t extent);
+
+        [[nodiscard]] size_t get_size() const;
+        // Coefficients along the last axis
+        [[nodiscard]] size_t get_half_size() const;
+
+    private:
+        size_t size = 0;
+        // exp(-2 pi i k / size) for k < size / 2
+        aligned_vector<float> twiddles_real;
+        aligned_vector<float> twiddles_imaginary;
+        std::vector<u_int> reversal;
+        std::vector<u_int> half_reversal;
+        // Real and imaginary parts of a block of lines of every thread, value major
+        std::vector<aligned_vector<float>> buffers;
+
+        // Transform of the block of lines stored in a buffer
+        void transform(float* real, float* imaginary, bool backward, bool half) const;
+        // Every line of outer_count planes along an axis of the half spectrum with the given stride
+        void transform_axis(Complex* data, size_t outer_count, size_t outer_stride, size_t stride, bool backward);
+};
+
+#endif // FFT_HPP
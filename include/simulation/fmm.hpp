@@ -0,0 +1,117 @@
+/*
+ * @path include/simulation/fmm.hpp
+ * @file fmm.hpp
+*/
+
+#ifndef FMM_HPP
+#define FMM_HPP
+
+#include <array>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../octree/tree.hpp"
+#include "../simulation/n_body.hpp"
+
+// Fast multipole method over the linear octree. Every node carries a Cartesian Taylor multipole
+// expansion about its center of mass, far cells are turned into local expansions (M2L) and
+// pushed down the tree (L2L), so the force evaluation is O(N) instead of O(N log N).
+class FMM : public NBody {
+    public:
+        static constexpr int MAX_ORDER = 8;
+        // A batched transfer costs about as much as this many body pairs per transfer term
+        static constexpr float DIRECT_PAIRS_PER_TERM = 0.5f;
+        // Sources transferred to one target together, one per SIMD lane
+        static constexpr int BATCH = 8;
+
+        explicit FMM(int bodies_count = 10000);
+        FMM(const FMM&) = delete;
+        FMM(FMM&&) = delete;
+        FMM& operator=(const FMM&) = delete;
+        FMM& operator=(FMM&&) = delete;
+        ~FMM() override = default;
+
+    protected:
+        void calculate_forces() final;
+
+    private:
+        // Multi-indices (a, b, c) of the expansion terms ordered by degree, so the terms up to
+        // any degree are a prefix. The transfers stop at the order, so do the kernel derivatives.
+        struct Terms {
+            // Derivative R(j)[a, b, c] from R(j + 1) at the lower indices on the recursion axis,
+            // a missing second index has a zero coefficient
+            struct Step {
+                int axis = 0;
+                int lower = 0;
+                int lower_twice = 0;
+                double coefficient = 0.0;
+            };
+
+            // Translation of one term: target += source * d^offset / offset!
+            struct Shift {
+                int target;
+                int source;
+                int offset;
+            };
+
+            int order = -1;
+            std::vector<std::array<int, 3>> exponents;
+            std::vector<double> inverse_factorials;
+            std::vector<Step> steps;
+            std::vector<Shift> shifts;
+            // Derivative of every (local, multipole) pair, local major, and the multipoles per local
+            std::vector<int> transfers;
+            std::vector<int> transfer_counts;
+            std::vector<std::array<int, 3>> gradients;
+
+            void prepare(int order);
+            [[nodiscard]] static int count(int degree);
+            [[nodiscard]] int size() const;
+        };
+
+        // Kept between steps so that the steady-state loop does not allocate
+        Tree octree;
+        Bound bound = Bound(glm::vec3(0.0f), 10.0f);
+        int steps_since_build = 0;
+        Terms terms;
+
+        // Source cells a node left to its children, stored in the buffer of the thread that
+        // walked the node
+        struct Deferred {
+            u_int thread = 0;
+            u_int begin = 0;
+            u_int end = 0;
+        };
+
+        // Expansions of every node, node major
+        std::vector<double> multipoles;
+        std::vector<double> locals;
+        std::vector<float> radii;
+        std::vector<u_int> parents;
+
+        // Bodies left out of the tree, tracers and those past the interaction percentage, sorted
+        // by the leaf whose expansion they are evaluated with, and the first of every node
+        std::vector<u_int> outside_leaves;
+        std::vector<u_int> outside_bodies;
+        std::vector<u_int> outside_offsets;
+
+        // Dual tree traversal state, one level is read while the next one is written
+        std::vector<Deferred> deferred;
+        std::array<std::vector<std::vector<u_int>>, 2> deferred_buffers;
+        std::vector<InteractionList> neighbours;
+        std::vector<aligned_vector<double>> scratches;
+
+        // Hands every body from first to last to the leaf nearest to it, the one containing it
+        // unless it lies in an empty octant or outside the root
+        void locate_outside(size_t first, size_t last);
+        void upward();
+        void downward(float theta, float softening_squared);
+        void interact(u_int target, const u_int* candidates, size_t candidate_count, float theta, double softening_squared, std::vector<u_int>& children, std::vector<std::pair<u_int, u_int>>& ranges, double* scratch);
+        void evaluate(u_int leaf, InteractionList& near, float softening_squared);
+
+        void powers(const glm::dvec3& d, int degree, double* result) const;
+        void transfer(u_int target, const u_int* sources, int count, double softening_squared, double* scratch);
+        [[nodiscard]] bool separated(u_int a, u_int b, float theta) const;
+};
+
+#endif // FMM_HPP
@@ -0,0 +1,28 @@
+/*
+ * @path include/simulation/kepler.hpp
+ * @file kepler.hpp
+*/
+
+#ifndef KEPLER_HPP
+#define KEPLER_HPP
+
+#include <glm/glm.hpp>
+
+// Exact two body motion, used where a Kepler orbit is split off the rest of the forces
+class Kepler {
+    public:
+        // Kepler equation solved to this relative change of the universal anomaly
+        static constexpr double TOLERANCE = 1e-13;
+        static constexpr int ITERATIONS = 32;
+
+        // Advances a position and velocity relative to a central mass mu = G M along the Kepler
+        // orbit, for any eccentricity and either direction of time, with the universal variable
+        // formulation and the f and g functions
+        static void drift(double mu, double delta_time, glm::dvec3& position, glm::dvec3& velocity);
+
+    private:
+        // Stumpff functions c0 to c3 of z, c_k(z) = sum over n of (-z)^n / (k + 2n)!
+        static void stumpff(double z, double (&c)[4]);
+};
+
+#endif // KEPLER_HPP
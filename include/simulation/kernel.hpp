@@ -0,0 +1,140 @@
+/*
+ * @path include/simulation/kernel.hpp
+ * @file kernel.hpp
+*/
+
+#ifndef KERNEL_HPP
+#define KERNEL_HPP
+
+#include <array>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "aligned_allocator.hpp"
+
+// Packed batch of gravity sources (bodies or cell centers of mass) for one target
+struct InteractionList {
+    std::array<aligned_vector<float>, 3> position;
+    aligned_vector<float> mass;
+
+    // Second and third moments of the cells about their centers of mass, only filled when the
+    // cells carry them, in the order xx xy xz yy yz zz and xxx xxy xxz xyy xyz xzz yyy yyz yzz zzz
+    std::array<aligned_vector<float>, 6> quadrupole;
+    std::array<aligned_vector<float>, 10> octupole;
+
+    // Velocities of the sources, only filled when the jerk is computed
+    std::array<aligned_vector<float>, 3> velocity;
+
+    // Ranges of sources evaluated in place, e.g. the contiguous bodies of an opened leaf
+    std::vector<std::pair<u_int, u_int>> ranges;
+
+    void push(const glm::vec3& source_position, float source_mass);
+    // Copies of contiguous sources, for lists too short to be worth evaluating the ranges apart
+    void append(const float* x, const float* y, const float* z, const float* source_mass, size_t count);
+    void push_moments(const float* source_quadrupole, const float* source_octupole);
+    void push_velocity(const glm::vec3& source_velocity);
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+};
+
+// Plummer softened particle-particle kernels, the widest instruction set supported by
+// the running CPU is selected once at startup. The sums over sources are also compiled for
+// planar runs (dimension 2), which skip the z components of the sources and the target.
+class Kernel {
+    public:
+        enum class Isa {
+            SCALAR,
+            SSE4,
+            AVX2,
+            AVX512
+        };
+
+        // Acceleration and its time derivative
+        struct Derivatives {
+            glm::vec3 acceleration = glm::vec3(0.0f);
+            glm::vec3 jerk = glm::vec3(0.0f);
+
+            Derivatives& operator+=(const Derivatives& other);
+        };
+
+        // Sources farther than this many split scales are left to the long range solver
+        static constexpr float SHORT_RANGE_CUTOFF = 4.5f;
+        // Distance r at which the softened distance s reaches the cutoff, zero when the softening
+        // alone does and the long range solver has the whole force
+        static float short_range_reach(float split, float softening_squared);
+
+        // Sum of m * r / (r^2 + softening^2)^(3/2) over the sources, gravity is not applied
+        static glm::vec3 evaluate(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, u_int dimension = 3);
+        static glm::vec3 evaluate(const glm::vec3& target, const InteractionList& sources, float softening_squared, u_int dimension = 3);
+        // Same sum for the target, the reaction of every pair is subtracted from ax, ay and az of the sources
+        static glm::vec3 evaluate_pairs(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared, u_int dimension = 3);
+        // Short range part of the sum for a long range force of the potential erf(s / 2 split) / s
+        // computed elsewhere, every term is weighted by erfc(u) + 2 u / sqrt(pi) exp(-u^2) with
+        // u = s / 2 split and s^2 = r^2 + softening^2
+        static glm::vec3 evaluate_short_range(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split, u_int dimension = 3);
+        static glm::vec3 evaluate_short_range(const glm::vec3& target, const InteractionList& sources, float softening_squared, float split, u_int dimension = 3);
+        // Cells expanded up to the quadrupole (degree 2) or the octupole (degree 3) moments
+        static glm::vec3 evaluate_multipoles(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree, u_int dimension = 3);
+        // The sum above and its time derivative m (v / s^3 - 3 (r . v) r / s^5) for a moving target,
+        // with r and v relative to the target and s^2 = r^2 + softening^2
+        static Derivatives evaluate_jerk(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared);
+        static Derivatives evaluate_jerk(const glm::vec3& target, const glm::vec3& target_velocity, const InteractionList& sources, float softening_squared);
+
+        [[nodiscard]] static Isa get_isa();
+        [[nodiscard]] static std::string_view get_isa_name();
+
+    private:
+        using Function = glm::vec3 (*)(const glm::vec3&, const float*, const float*, const float*, const float*, size_t, float);
+        using PairFunction = glm::vec3 (*)(const glm::vec3&, float, const float*, const float*, const float*, const float*, float*, float*, float*, size_t, float);
+        using ShortRangeFunction = glm::vec3 (*)(const glm::vec3&, const float*, const float*, const float*, const float*, size_t, float, float);
+        using MultipoleFunction = glm::vec3 (*)(const glm::vec3&, const InteractionList&, float, int);
+        using JerkFunction = Derivatives (*)(const glm::vec3&, const glm::vec3&, const float*, const float*, const float*, const float*, const float*, const float*, const float*, size_t, float);
+
+        template <u_int DIMENSION>
+        static Function select(Isa isa);
+        template <u_int DIMENSION>
+        static PairFunction select_pairs(Isa isa);
+        template <u_int DIMENSION>
+        static ShortRangeFunction select_short_range(Isa isa);
+        template <u_int DIMENSION>
+        static MultipoleFunction select_multipoles(Isa isa);
+        static JerkFunction select_jerk(Isa isa);
+
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_scalar(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_sse4(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_avx2(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_avx512(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared);
+
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_pairs_scalar(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_pairs_avx2(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_pairs_avx512(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared);
+
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_short_range_scalar(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_short_range_avx2(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_short_range_avx512(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split);
+
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_multipoles_scalar(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_multipoles_avx2(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree);
+        template <u_int DIMENSION>
+        static glm::vec3 evaluate_multipoles_avx512(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree);
+
+        static Derivatives evaluate_jerk_scalar(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared);
+        static Derivatives evaluate_jerk_avx2(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared);
+        static Derivatives evaluate_jerk_avx512(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared);
+};
+
+#endif // KERNEL_HPP
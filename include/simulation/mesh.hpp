@@ -0,0 +1,87 @@
+/*
+ * @path include/simulation/mesh.hpp
+ * @file mesh.hpp
+*/
+
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+#include "aligned_allocator.hpp"
+#include "body_store.hpp"
+#include "bound.hpp"
+#include "fft.hpp"
+
+// Gravity of the bodies on a regular grid. The masses are assigned to the grid nodes, the
+// potential is the convolution with the Green's function computed by FFT on a grid of twice
+// the size (zero padded, so the bodies are isolated instead of periodic), and the forces are
+// the finite differences of the potential interpolated back to the bodies.
+class Mesh {
+    public:
+        enum class Assignment {
+            CLOUD_IN_CELL,
+            TRIANGULAR_SHAPED_CLOUD
+        };
+
+        // Bodies stay this many cells away from the faces, so the widest assignment stencil
+        // and the finite differences around it never leave the grid
+        static constexpr int MARGIN = 4;
+        static constexpr int MIN_SIZE = 4 * MARGIN;
+        // The zero padded transform of this size already takes 8 GB
+        static constexpr int MAX_SIZE = 512;
+
+        // Fit a grid of size^3 nodes to the bound and assign the masses of the first count bodies,
+        // size is rounded up to a power of two, at most MAX_SIZE. Bodies outside the bound are moved onto its faces,
+        // or left out when bounded.
+        void assign(const BodyStore& bodies, size_t count, const Bound& bound, int size, Assignment assignment, bool bounded = false);
+
+        // Potential and forces of the assigned masses, Plummer softened. With a split scale only
+        // the long range part erf(s / 2 split) / s is kept, s the softened distance.
+        void solve(float gravity, float softening, float split = 0.0f);
+
+        // Acceleration at a position, positions outside the grid get the one at the closest node
+        [[nodiscard]] glm::vec3 interpolate(const glm::vec3& position) const;
+
+        [[nodiscard]] int get_size() const;
+        [[nodiscard]] float get_cell_size() const;
+
+    private:
+        // Nodes and weights of the assignment of one coordinate
+        struct Stencil {
+            int first = 0;
+            std::array<float, 3> weights {};
+        };
+
+        // Parameters the Green's function was computed with, it is only redone when they change
+        struct Parameters {
+            int size = 0;
+            float cell_size = 0.0f;
+            float softening = 0.0f;
+            float split = 0.0f;
+            Assignment assignment = Assignment::CLOUD_IN_CELL;
+
+            bool operator==(const Parameters& other) const;
+        };
+
+        int size = 0;
+        float cell_size = 1.0f;
+        glm::vec3 origin = glm::vec3(0.0f);
+        Assignment assignment = Assignment::CLOUD_IN_CELL;
+        Parameters parameters;
+
+        FFT fft;
+        // Masses and then potential on the padded grid, spectra on its half spectrum
+        aligned_vector<float> grid;
+        std::vector<FFT::Complex> spectrum;
+        aligned_vector<float> green;
+        std::vector<aligned_vector<float>> thread_grids;
+        std::array<aligned_vector<float>, 3> forces;
+
+        void prepare_green(const Parameters& requested);
+        [[nodiscard]] Stencil stencil(float coordinate) const;
+        [[nodiscard]] int width() const;
+};
+
+#endif // MESH_HPP
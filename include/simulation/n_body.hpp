@@ -6,21 +6,82 @@
 #ifndef N_BODY_HPP
 #define N_BODY_HPP
 
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <random>
+#include <memory>
+#include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "graphics/shader.hpp"
+#include "body_store.hpp"
+#include "potential.hpp"
+#include "octree/tree.hpp"
 
 class NBody {
     public:
+        enum class Integrator {
+            // Taylor step of the positions and damped velocities, one force pass per step
+            EULER,
+            // Kick-drift-kick leapfrog, symplectic and undamped, one force pass per step
+            LEAPFROG,
+            // Fourth order composition of three leapfrog steps (Yoshida), three force passes per step
+            YOSHIDA,
+            // Leapfrog with individual power of two steps, only the bodies ending a step get forces
+            BLOCK,
+            // Fourth order Hermite predictor-corrector from the acceleration and its derivative,
+            // one force pass per step. Solvers without a jerk leave it at zero.
+            HERMITE,
+            // Multiple time stepping (impulse RESPA): the far field kicks every far_field_interval
+            // steps, the leapfrog in between only recomputes the near field
+            RESPA
+        };
+
+        // Finest block step is delta_time / 2^MAX_TIMESTEP_LEVEL
+        static constexpr int MAX_TIMESTEP_LEVEL = 16;
+
         float gravity = 0.04f;
         float softening_factor = 10.0f;
         float radius = 3.0f;
         float theta = 0.7f;
+        Tree::Opening opening = Tree::Opening::GEOMETRIC;
+        // Tolerated force error relative to the acceleration of the previous step, relative opening only
+        float force_accuracy = 0.0025f;
+        // Highest moment of the tree cells, 0 or 1 for the monopole, 2 quadrupole, 3 octupole
+        int multipole_degree = 0;
         float interaction_percentage = 1.0f;
         float damping = 0.995f;
+        Integrator integrator = Integrator::EULER;
+        // Block steps: levels below the frame step and the accuracy eta of the step |a| / |da/dt| eta
+        int timestep_levels = 6;
+        float timestep_accuracy = 0.02f;
+        // Multiple time stepping: steps between two far field passes and the split scale of the
+        // near field of the tree walk
+        int far_field_interval = 4;
+        float near_field_scale = 0.05f;
         float mass = 1.5f;
+        int leaf_capacity = 16;
+        float bound_hysteresis = 0.1f;
+        int refit_interval = 1;
+        bool group_walk = true;
+        int expansion_order = 4;
+        // The multipole method keeps larger leaves than the tree walk, its transfers cost more
+        // than the pairs they replace
+        int fmm_leaf_capacity = 32;
+        bool symmetric_pairs = false;
+        int mesh_size = 64;
+        bool triangular_shaped_cloud = false;
+        // Central mass of the planetary mode, not one of the bodies
+        float star_mass = 1000.0f;
+        // Leapfrog steps: bound pairs closer than this move on their unsoftened Kepler orbit about
+        // each other, only the rest of the forces are kicks. 0 disables.
+        float encounter_radius = 0.0f;
+        // Analytic background field added to the forces of every integrator, empty by default
+        Potential potential;
+        // 2D runs: the bodies start in the xy plane and stay there, the tree is a quadtree.
+        // Takes effect on the next reset.
+        bool planar = false;
 
         glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
         glm::vec3 rotation = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -32,22 +93,133 @@ class NBody {
         NBody& operator=(const NBody&) = delete;
         NBody& operator=(NBody&&) noexcept = delete;
 
-        virtual ~NBody() = default;
+        virtual ~NBody();
 
-        virtual void update(const float& delta_time) = 0;
-        virtual void render(glm::mat4 view, glm::mat4 view_projection) = 0;
-        virtual void reset() = 0;
+        // Solvers only differ in how they compute the accelerations, the bodies, their
+        // integration and rendering are shared
+        virtual void update(const float& delta_time);
+        virtual void render(glm::mat4 view, glm::mat4 view_projection);
+        virtual void reset();
         void update_model_matrix();
+        void clear();
+        void randomize();
 
         void set_paused(bool paused);
         [[nodiscard]] bool is_paused() const;
 
-        [[nodiscard]] virtual size_t get_body_count() const = 0;
-        virtual void set_body_count(const size_t& body_count) = 0;
+        [[nodiscard]] virtual size_t get_body_count() const;
+        virtual void set_body_count(const size_t& body_count);
+        // The last bodies are massless tracers, they feel gravity but do not source it
+        [[nodiscard]] size_t get_tracer_count() const;
+        void set_tracer_count(const size_t& tracer_count);
+        // Whether the block steps can get the forces of the active bodies alone. The others would
+        // redo the whole pass on every tick, the launcher and the headless run refuse block steps
+        // for them.
+        [[nodiscard]] virtual bool has_active_forces() const;
 
     protected:
+        struct Encounter {
+            u_int first;
+            u_int second;
+        };
+
         glm::mat4 model_matrix;
         bool paused = false;
+
+        BodyStore bodies;
+        size_t tracer_count = 0;
+        // Components integrated and split by the tree, 2 when the last reset was planar
+        u_int dimension = 3;
+
+        // Bodies sourcing gravity, the first interaction_percentage of the ones with mass
+        [[nodiscard]] size_t get_source_count() const;
+
+        // Force phase: accelerations of every body at the current positions, written to the
+        // store. Positions are not modified until the pass is over.
+        virtual void calculate_forces() = 0;
+        // Accelerations of the active bodies only, the others may keep stale ones. Solvers without
+        // a cheaper way do a full pass.
+        virtual void calculate_active_forces(const std::vector<u_int>& active);
+        // Block steps: only the active bodies are drifted to the current tick, the others are
+        // brought there when a solver reads their positions, e.g. to refit its tree
+        void predict_positions();
+        // Pairs of bodies within the radius of each other, each the nearest neighbor of the other.
+        // Called after a force pass, solvers without a tree find none.
+        virtual void find_close_pairs(float radius, std::vector<Encounter>& pairs);
+        // Multiple time stepping: the far part of the accelerations into far and the near part
+        // into the store, then only the near part until the next far pass. Solvers without a
+        // split leave the far part at zero and recompute everything.
+        virtual void calculate_far_forces(std::array<aligned_vector<float>, 3>& far);
+        virtual void calculate_near_forces();
+
+        // Advance the bodies by one step from the accelerations in the store
+        void integrate(float delta_time);
+        void kick(float delta_time);
+        void drift(float delta_time);
+        void kick_drift_kick(float delta_time);
+        void block_step(float delta_time);
+        void hermite_step(float delta_time);
+        void respa_step(float delta_time);
+
+        // Whether the accelerations in the store belong to the current positions, a leapfrog
+        // step then starts with them instead of a force pass
+        bool forces_current = false;
+        Integrator stepped_with = Integrator::EULER;
+
+    private:
+        static const char* const vertex_shader;
+        static const char* const fragment_shader;
+
+        // Created on the first render so that the simulation can also run without a GL context
+        std::unique_ptr<Shader> shader;
+        GLuint vao = 0, position_vbo = 0, color_vbo = 0;
+        bool colors_dirty = true;
+
+        // Block steps: level of every body, the acceleration of its last force pass, the bodies
+        // of every level and the bodies ending their step on the current tick
+        std::vector<uint8_t> body_levels;
+        std::array<aligned_vector<float>, 3> previous_accelerations;
+        std::vector<std::vector<u_int>> level_bodies;
+        std::vector<u_int> active;
+        // Tick every body was last drifted to and the current one, 0 outside of the ticks
+        std::vector<u_int> body_ticks;
+        u_int block_tick = 0;
+        float tick_length = 0.0f;
+
+        // Hermite: state at the start of the step, the store holds the predicted one meanwhile
+        struct Snapshot {
+            std::array<aligned_vector<float>, 3> position;
+            std::array<aligned_vector<float>, 3> velocity;
+            std::array<aligned_vector<float>, 3> acceleration;
+            std::array<aligned_vector<float>, 3> jerk;
+        };
+        Snapshot start;
+
+        // Multiple time stepping: far accelerations of the last far pass, the steps taken since and
+        // the interval they were taken with
+        std::array<aligned_vector<float>, 3> far_accelerations;
+        int far_step = 0;
+        int far_steps = 1;
+
+        // Bound close pairs of the current force pass and their state after the drift
+        std::vector<Encounter> encounters;
+        std::vector<std::array<glm::vec3, 4>> encounter_states;
+
+        [[nodiscard]] int choose_level(size_t index, float delta_time, float body_step, int levels) const;
+
+        void kick_far(float delta_time);
+        // Acceleration of the external potential on top of the force pass, of the active bodies
+        // only when given
+        void add_external_forces(const std::vector<u_int>* active = nullptr);
+        void add_external_far_forces();
+        // Force pass with the jerk of the external potential
+        void calculate_hermite_forces();
+        // Keeps the bound close pairs and takes their mutual force off the accelerations
+        void update_encounters();
+        // Drift in which the bodies of the encounters follow their Kepler orbits about each other
+        void drift_encounters(float delta_time);
+
+        void create_buffers();
 };
 
 #endif // N_BODY_HPP
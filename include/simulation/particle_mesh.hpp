@@ -0,0 +1,34 @@
+/*
+ * @path include/simulation/particle_mesh.hpp
+ * @file particle_mesh.hpp
+*/
+
+#ifndef PARTICLE_MESH_HPP
+#define PARTICLE_MESH_HPP
+
+#include <glm/glm.hpp>
+#include "../simulation/bound.hpp"
+#include "../simulation/mesh.hpp"
+#include "../simulation/n_body.hpp"
+
+// Forces from the potential of the bodies on a grid, O(N + M log M) per step for M grid nodes.
+// Structure smaller than a few cells is smoothed out, so it suits large and smooth systems.
+class ParticleMesh : public NBody {
+    public:
+        explicit ParticleMesh(int bodies_count = 10000);
+        ParticleMesh(const ParticleMesh&) = delete;
+        ParticleMesh(ParticleMesh&&) = delete;
+        ParticleMesh& operator=(const ParticleMesh&) = delete;
+        ParticleMesh& operator=(ParticleMesh&&) = delete;
+        ~ParticleMesh() override = default;
+
+    protected:
+        void calculate_forces() final;
+
+    private:
+        // Kept between steps so that the steady-state loop does not allocate
+        Mesh mesh;
+        Bound bound = Bound(glm::vec3(0.0f), 10.0f);
+};
+
+#endif // PARTICLE_MESH_HPP
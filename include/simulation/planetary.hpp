@@ -0,0 +1,41 @@
+/*
+ * @path include/simulation/planetary.hpp
+ * @file planetary.hpp
+*/
+
+#ifndef PLANETARY_HPP
+#define PLANETARY_HPP
+
+#include <glm/glm.hpp>
+#include "../simulation/barnes_hut.hpp"
+
+// Bodies orbiting a dominant central mass, integrated with the Wisdom-Holman map in democratic
+// heliocentric coordinates: positions relative to the star, velocities relative to the barycenter.
+// The Kepler orbit about the star is solved exactly every step and only the interactions of the
+// bodies with each other, computed by the tree walk at the theta setting, are kicks. The step
+// then only has to resolve the perturbations instead of the orbits. The star of star_mass is
+// not one of the bodies, a change of it takes effect on the next reset.
+class Planetary : public BarnesHut {
+    public:
+        explicit Planetary(int bodies_count = 10000);
+        Planetary(const Planetary&) = delete;
+        Planetary(Planetary&&) = delete;
+        Planetary& operator=(const Planetary&) = delete;
+        Planetary& operator=(Planetary&&) = delete;
+        ~Planetary() override = default;
+
+        // Kick, drift with the momentum of the star, Kepler drift, drift, kick. The integrator
+        // setting and the external potential do not apply.
+        void update(const float& delta_time) final;
+        void reset() final;
+        void set_body_count(const size_t& body_count) final;
+
+    private:
+        // Circular orbits in a thin disk between half the radius and the radius
+        void place_on_orbits();
+        void kepler_drift(float delta_time);
+        // Drift of every position by the total momentum over the star mass
+        void drift_barycenter(float delta_time);
+};
+
+#endif // PLANETARY_HPP
@@ -0,0 +1,58 @@
+/*
+ * @path include/simulation/potential.hpp
+ * @file potential.hpp
+*/
+
+#ifndef POTENTIAL_HPP
+#define POTENTIAL_HPP
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+#include "body_store.hpp"
+
+// Static analytic potential added to the forces of the bodies, e.g. a dark matter halo, a bulge
+// or a disk that would otherwise take most of the bodies. The components are summed.
+class Potential {
+    public:
+        enum class Profile {
+            // -G M / sqrt(r^2 + a^2), a Plummer sphere when the scale is not zero
+            POINT_MASS,
+            // -G M / (r + a)
+            HERNQUIST,
+            // -G M ln(1 + r / rs) / r with the mass M = 4 pi rho0 rs^3
+            NFW,
+            // -G M / sqrt(R^2 + (a + sqrt(z^2 + b^2))^2), a disk in the xy plane
+            MIYAMOTO_NAGAI,
+            // v0^2 / 2 ln(rc^2 + R^2 + z^2 / q^2), flat rotation curve at large radii
+            LOGARITHMIC
+        };
+
+        struct Component {
+            Profile profile = Profile::HERNQUIST;
+            // Unused by the logarithmic potential
+            float mass = 1000.0f;
+            // a, rs or rc
+            float scale = 1.0f;
+            // Miyamoto-Nagai scale height b, logarithmic axis ratio q
+            float shape = 0.1f;
+            // Logarithmic v0
+            float velocity = 1.0f;
+            glm::vec3 center = glm::vec3(0.0f);
+        };
+
+        // Relative step of the central difference of the jerk, in units of the component scale
+        static constexpr float JERK_STEP = 1e-3f;
+        // Smallest NFW scale radius and axis ratio, the profiles divide by them
+        static constexpr float MIN_SCALE = 0.01f;
+
+        std::vector<Component> components;
+
+        [[nodiscard]] bool empty() const;
+
+        // Adds the acceleration of every component at the positions of the bodies, or of the
+        // active ones only, and with a jerk array the change of the acceleration along the velocity
+        void accelerate(const BodyStore& bodies, float gravity, std::array<aligned_vector<float>, 3>& acceleration, std::array<aligned_vector<float>, 3>* jerk = nullptr, const std::vector<u_int>* active = nullptr) const;
+};
+
+#endif // POTENTIAL_HPP
@@ -0,0 +1,60 @@
+/*
+ * @path include/simulation/tree_pm.hpp
+ * @file tree_pm.hpp
+*/
+
+#ifndef TREE_PM_HPP
+#define TREE_PM_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "../simulation/barnes_hut.hpp"
+#include "../simulation/bound.hpp"
+#include "../simulation/mesh.hpp"
+
+// Long range forces from the mesh and short range forces from the tree walk, split with erf and
+// erfc at a scale of a few mesh cells. The walk ends at the cutoff of the short range kernel, so
+// clustered regions keep the tree resolution while the far field costs one FFT. The mesh only
+// covers the bulk of the sources, the pairs with a body outside it are left to the tree walk.
+class TreePM : public BarnesHut {
+    public:
+        // Split scale in mesh cells
+        static constexpr float SPLIT_CELLS = 1.25f;
+        // Share of the sources in the cube of the mesh about their center of mass
+        static constexpr float MESH_FRACTION = 0.95f;
+        // The rest are only left out when the farthest of them is this many times farther out
+        static constexpr float OUTLIER_REACH = 2.0f;
+
+        explicit TreePM(int bodies_count = 10000);
+        TreePM(const TreePM&) = delete;
+        TreePM(TreePM&&) = delete;
+        TreePM& operator=(const TreePM&) = delete;
+        TreePM& operator=(TreePM&&) = delete;
+        ~TreePM() override = default;
+
+    protected:
+        void calculate_forces() final;
+        void calculate_active_forces(const std::vector<u_int>& active) final;
+        // The mesh is the far field, the short range walk the near field
+        void calculate_far_forces(std::array<aligned_vector<float>, 3>& far) final;
+        void calculate_near_forces() final;
+
+    private:
+        // Kept between steps so that the steady-state loop does not allocate
+        Mesh mesh;
+        Bound mesh_bound = Bound(glm::vec3(0.0f), 10.0f);
+        // Split scale of the last mesh solve
+        float split = 0.0f;
+        std::vector<float> extents;
+
+        // Cube about the center of mass of the first count bodies holding MESH_FRACTION of them, or
+        // all of them when none lies far out
+        [[nodiscard]] Bound fit_bulk(size_t count);
+        void solve_mesh();
+
+        // The block steps keep the mesh of the last full pass, the far field hardly changes
+        // within a frame step. Only the active bodies are walked and interpolated.
+        void calculate_split_forces(const std::vector<u_int>* active);
+};
+
+#endif // TREE_PM_HPP
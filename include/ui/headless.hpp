@@ -0,0 +1,62 @@
+/*
+ * @path include/ui/headless.hpp
+ * @file headless.hpp
+*/
+
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <string_view>
+#include <vector>
+#include "scene/scene.hpp"
+
+// Runs the simulation without a window and reports the time per step, used to tune the
+// simulator settings from the command line, e.g.
+//     universe --headless --bodies 1000000 --steps 20 --leaf-capacity 8,16,32,64
+//     universe --headless --solver fmm --order 6 --theta 0.5
+//     universe --headless --solver pm --mesh 128 --bodies 10000000
+class Headless {
+    public:
+        static constexpr std::string_view FLAG = "--headless";
+
+        struct Settings {
+            Scene::Solver solver = Scene::Solver::BARNES_HUT;
+            int body_count = 100000;
+            int tracer_count = 0;
+            bool planar = false;
+            int steps = 10;
+            float delta_time = 1.0f / 60.0f;
+            NBody::Integrator integrator = NBody::Integrator::EULER;
+            int timestep_levels = 6;
+            float timestep_accuracy = 0.02f;
+            int far_field_interval = 4;
+            float near_field_scale = 0.05f;
+            float encounter_radius = 0.0f;
+            float theta = 0.7f;
+            Tree::Opening opening = Tree::Opening::GEOMETRIC;
+            float force_accuracy = 0.0025f;
+            int multipole_degree = 0;
+            int refit_interval = 1;
+            bool group_walk = true;
+            int expansion_order = 4;
+            int fmm_leaf_capacity = 32;
+            bool symmetric_pairs = false;
+            int mesh_size = 64;
+            bool triangular_shaped_cloud = false;
+            float star_mass = 1000.0f;
+            std::vector<Potential::Component> potential;
+            std::vector<int> leaf_capacities = {16};
+        };
+
+        explicit Headless(const Settings& settings);
+
+        void start() const;
+
+        [[nodiscard]] static bool requested(int argc, char** argv);
+        [[nodiscard]] static Settings parse(int argc, char** argv);
+
+    private:
+        Settings settings;
+};
+
+#endif // HEADLESS_HPP
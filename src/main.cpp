@@ -5,14 +5,21 @@
 
 #include <iostream>
 #include "ui/launcher.hpp"
+#include "ui/headless.hpp"
 
-int main(void) {
+int main(int argc, char** argv) {
    
     std::cout << Launcher::TITLE << std::endl;
     std::cout << Launcher::AUTHOR << std::endl;
     std::cout << Launcher::VERSION << std::endl;
     std::cout << Launcher::PROJECT_URL << std::endl;
 
+    if (Headless::requested(argc, argv)) {
+        Headless headless(Headless::parse(argc, argv));
+        headless.start();
+        return 0;
+    }
+
     Launcher launcher;
     launcher.start();
 
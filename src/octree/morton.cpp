@@ -0,0 +1,127 @@
+/*
+ * @path src/octree/morton.cpp
+ * @file morton.cpp
+*/
+
+#include <algorithm>
+#include <array>
+#include <omp.h>
+#include "octree/morton.hpp"
+
+template <>
+uint64_t Morton::expand_bits<3>(uint64_t value) {
+    // Spread the lower 21 bits so that there are two zero bits between each of them
+    value &= 0x1fffff;
+    value = (value | value << 32) & 0x1f00000000ffff;
+    value = (value | value << 16) & 0x1f0000ff0000ff;
+    value = (value | value << 8) & 0x100f00f00f00f00f;
+    value = (value | value << 4) & 0x10c30c30c30c30c3;
+    value = (value | value << 2) & 0x1249249249249249;
+    return value;
+}
+
+template <>
+uint64_t Morton::expand_bits<2>(uint64_t value) {
+    // Spread the lower 24 bits so that there is one zero bit between each of them
+    value &= 0xffffff;
+    value = (value | value << 16) & 0x0000ffff0000ffff;
+    value = (value | value << 8) & 0x00ff00ff00ff00ff;
+    value = (value | value << 4) & 0x0f0f0f0f0f0f0f0f;
+    value = (value | value << 2) & 0x3333333333333333;
+    value = (value | value << 1) & 0x5555555555555555;
+    return value;
+}
+
+template <u_int DIMENSION>
+uint64_t Morton::encode(const glm::vec3& position, const Bound& bound) {
+    constexpr uint64_t cells = uint64_t(1) << BITS<DIMENSION>;
+    const float scale = static_cast<float>(cells) / (2.0f * bound.half_width);
+    const glm::vec3 cell = (position - (bound.center - bound.half_width)) * scale;
+
+    // Positions outside the bound are clamped into its border cells
+    // x takes the lowest bit of every level to match the child ordering of Node
+    uint64_t key = 0;
+    for (u_int k = 0; k < DIMENSION; ++k) {
+        const auto index = static_cast<uint64_t>(glm::clamp(cell[k], 0.0f, static_cast<float>(cells)));
+        key |= expand_bits<DIMENSION>(std::min(index, cells - 1)) << k;
+    }
+    return key;
+}
+
+template <u_int DIMENSION>
+u_int Morton::child(uint64_t key, u_int depth) {
+    // The root splits on the most significant level of the key
+    return static_cast<u_int>(key >> (DIMENSION * (BITS<DIMENSION> - 1 - depth))) & (CHILDREN<DIMENSION> - 1);
+}
+
+template uint64_t Morton::encode<2>(const glm::vec3& position, const Bound& bound);
+template uint64_t Morton::encode<3>(const glm::vec3& position, const Bound& bound);
+template u_int Morton::child<2>(uint64_t key, u_int depth);
+template u_int Morton::child<3>(uint64_t key, u_int depth);
+
+void Morton::sort(std::vector<uint64_t>& keys, std::vector<u_int>& indices, SortBuffer& buffer) {
+    const size_t count = keys.size();
+
+    auto& keys_buffer = buffer.keys;
+    auto& indices_buffer = buffer.indices;
+    keys_buffer.resize(count);
+    indices_buffer.resize(count);
+
+    // Every thread owns one contiguous chunk of the input and one histogram, scattering the
+    // chunks in order keeps the sort stable and independent of the number of threads
+    const int max_threads = omp_get_max_threads();
+    auto& histograms = buffer.histograms;
+    histograms.resize(max_threads);
+
+    for (u_int shift = 0; shift < 64; shift += RADIX_BITS) {
+        bool skip = false;
+
+        #pragma omp parallel num_threads(max_threads)
+        {
+            const auto thread = static_cast<size_t>(omp_get_thread_num());
+            const auto threads = static_cast<size_t>(omp_get_num_threads());
+            const size_t begin = count * thread / threads;
+            const size_t end = count * (thread + 1) / threads;
+            auto& histogram = histograms[thread];
+
+            histogram.fill(0);
+            for (size_t i = begin; i < end; ++i) {
+                ++histogram[(keys[i] >> shift) & (BUCKETS - 1)];
+            }
+
+            #pragma omp barrier
+            #pragma omp single
+            {
+                // Exclusive prefix sum, bucket major and thread minor
+                size_t offset = 0;
+                for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+                    size_t bucket_count = 0;
+                    for (size_t t = 0; t < threads; ++t) {
+                        bucket_count += histograms[t][bucket];
+                    }
+                    // Skip the pass when every key falls in the same bucket
+                    skip = skip || bucket_count == count;
+
+                    for (size_t t = 0; t < threads; ++t) {
+                        const size_t n = histograms[t][bucket];
+                        histograms[t][bucket] = offset;
+                        offset += n;
+                    }
+                }
+            }
+
+            if (!skip) {
+                for (size_t i = begin; i < end; ++i) {
+                    const size_t destination = histogram[(keys[i] >> shift) & (BUCKETS - 1)]++;
+                    keys_buffer[destination] = keys[i];
+                    indices_buffer[destination] = indices[i];
+                }
+            }
+        }
+
+        if (!skip) {
+            keys.swap(keys_buffer);
+            indices.swap(indices_buffer);
+        }
+    }
+}
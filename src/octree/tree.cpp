@@ -3,18 +3,907 @@
  * @file tree.cpp
 */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <omp.h>
 #include "octree/tree.hpp"
 
-Tree::Tree(Bound bound) : root(bound, 0) {}
+void Tree::build(const BodyStore& bodies, size_t count, const Bound& bound, u_int leaf_capacity, u_int dimension) {
+    this->leaf_capacity = std::max(leaf_capacity, 1u);
+    this->dimension = dimension == 2 ? 2 : 3;
 
-void Tree::insert(Body* body) {
-    root.insert(body);
+    keys.resize(count);
+    indices.resize(count);
+
+    // Compute the Morton keys, a body outside the bound is kept in the border cell closest to
+    // it so that it still sources gravity
+    #pragma omp parallel for
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = encode(bodies.get_position(i), bound);
+        indices[i] = static_cast<u_int>(i);
+    }
+
+    Morton::sort(keys, indices, sort_buffer);
+
+    const auto inserted = static_cast<u_int>(count);
+    gather(bodies);
+
+    // Nodes are emitted breadth first one level at a time, so every child is stored after its
+    // parent. Each level is split in parallel and the children are placed with a prefix sum,
+    // which gives the same layout for any number of threads.
+    nodes.reset();
+    nodes[nodes.allocate(1)] = Node(bound, 0, inserted, 0);
+    levels.assign({0, 1});
+
+    if (this->dimension == 2) {
+        build_levels<2>();
+    } else {
+        build_levels<3>();
+    }
+
+    // Remember the cells as built, refitting checks the bodies against them
+    cells.resize(nodes.size());
+    float leaf_width = 0.0f;
+
+    #pragma omp parallel for reduction(+:leaf_width)
+    for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(nodes.size()); ++i) {
+        cells[i] = nodes[i].bound;
+        leaf_width += nodes[i].is_leaf() ? nodes[i].bound.half_width : 0.0f;
+    }
+    built_leaf_width = leaf_width;
+
+    thread_traversal();
+}
+
+uint64_t Tree::encode(const glm::vec3& position, const Bound& bound) const {
+    return dimension == 2 ? Morton::encode<2>(position, bound) : Morton::encode<3>(position, bound);
+}
+
+template <u_int DIMENSION>
+void Tree::build_levels() {
+    while (levels.back() > levels[levels.size() - 2]) {
+        const u_int level_begin = levels[levels.size() - 2];
+        const u_int level_end = levels.back();
+        const auto level_size = static_cast<std::ptrdiff_t>(level_end - level_begin);
+
+        splits.resize(level_size);
+        child_offsets.resize(level_size + 1);
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (std::ptrdiff_t i = 0; i < level_size; ++i) {
+            child_offsets[i + 1] = split<DIMENSION>(nodes[level_begin + i], splits[i]);
+        }
+
+        child_offsets[0] = level_end;
+        for (std::ptrdiff_t i = 0; i < level_size; ++i) {
+            child_offsets[i + 1] += child_offsets[i];
+        }
+
+        nodes.allocate(child_offsets[level_size] - level_end);
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (std::ptrdiff_t i = 0; i < level_size; ++i) {
+            subdivide<DIMENSION>(level_begin + static_cast<u_int>(i), splits[i], child_offsets[i], child_offsets[i + 1] - child_offsets[i]);
+        }
+
+        levels.push_back(child_offsets[level_size]);
+    }
+}
+
+void Tree::thread_traversal() {
+    traversal.resize(nodes.size());
+    traversal[0].next = 0;
+
+    leaves.clear();
+    for (u_int i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].is_leaf()) {
+            leaves.push_back(i);
+        }
+    }
+
+    // Highest nodes within the group capacity of the split walks, in Morton order
+    split_groups.clear();
+    std::vector<u_int> stack {0};
+    while (!stack.empty()) {
+        const u_int index = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[index];
+        if (node.is_leaf() || node.body_count <= SPLIT_GROUP_CAPACITY) {
+            split_groups.push_back(index);
+            continue;
+        }
+        for (u_int j = node.first_child + node.child_count; j > node.first_child; --j) {
+            stack.push_back(j - 1);
+        }
+    }
+
+    // Skip pointers are set top-down, the last child continues where its parent does
+    for (size_t level = 0; level + 1 < levels.size(); ++level) {
+        const auto level_begin = static_cast<std::ptrdiff_t>(levels[level]);
+        const auto level_end = static_cast<std::ptrdiff_t>(levels[level + 1]);
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (std::ptrdiff_t i = level_begin; i < level_end; ++i) {
+            const Node& node = nodes[i];
+            TraversalNode& link = traversal[i];
+            link.first = node.is_leaf() ? node.first_body : node.first_child;
+            link.body_count = node.is_leaf() ? node.body_count : 0;
+
+            for (u_int j = node.first_child; j < node.first_child + node.child_count; ++j) {
+                traversal[j].next = j + 1 < node.first_child + node.child_count ? j + 1 : link.next;
+            }
+        }
+    }
+}
+
+void Tree::gather(const BodyStore& bodies) {
+    const auto count = static_cast<std::ptrdiff_t>(indices.size());
+    for (auto& component : positions) {
+        component.resize(count);
+    }
+    masses.resize(count);
+
+    #pragma omp parallel for
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            positions[k][i] = bodies.position[k][indices[i]];
+        }
+        masses[i] = bodies.mass[indices[i]];
+    }
+}
+
+bool Tree::refit(const BodyStore& bodies) {
+    if (indices.empty() || bodies.size() < indices.size()) {
+        return false;
+    }
+
+    gather(bodies);
+
+    bool escaped = false;
+    float leaf_width = 0.0f;
+
+    // Same bottom-up sweep as the center of mass pass, the bound of a node becomes the cube
+    // around the bodies of a leaf or around the refitted bounds of the children
+    for (size_t level = levels.size() - 1; level-- > 0;) {
+        const auto level_begin = static_cast<std::ptrdiff_t>(levels[level]);
+        const auto level_end = static_cast<std::ptrdiff_t>(levels[level + 1]);
+
+        #pragma omp parallel for schedule(dynamic, 256) reduction(||:escaped) reduction(+:leaf_width)
+        for (std::ptrdiff_t i = level_begin; i < level_end; ++i) {
+            Node& node = nodes[i];
+            glm::vec3 lower(std::numeric_limits<float>::max());
+            glm::vec3 upper(std::numeric_limits<float>::lowest());
+
+            if (node.is_leaf()) {
+                const Bound cell(cells[i].center, cells[i].half_width * (1.0f + REFIT_SLACK));
+                for (u_int j = node.first_body; j < node.first_body + node.body_count; ++j) {
+                    const glm::vec3 position(positions[0][j], positions[1][j], positions[2][j]);
+                    lower = glm::min(lower, position);
+                    upper = glm::max(upper, position);
+                    escaped = escaped || !cell.contains(position);
+                }
+            } else {
+                for (u_int j = node.first_child; j < node.first_child + node.child_count; ++j) {
+                    lower = glm::min(lower, nodes[j].bound.center - nodes[j].bound.half_width);
+                    upper = glm::max(upper, nodes[j].bound.center + nodes[j].bound.half_width);
+                }
+            }
+
+            const glm::vec3 extent = upper - lower;
+            node.bound = Bound(0.5f * (lower + upper), 0.5f * std::max({extent.x, extent.y, extent.z}));
+            leaf_width += node.is_leaf() ? node.bound.half_width : 0.0f;
+        }
+    }
+
+    return !escaped && leaf_width <= built_leaf_width * REFIT_QUALITY;
+}
+
+template <u_int DIMENSION>
+u_int Tree::split(const Node& node, std::array<u_int, 9>& octants) const {
+    // Nodes at the last Morton level hold coincident bodies and can not be split any further
+    if (node.body_count <= leaf_capacity || node.depth >= Morton::BITS<DIMENSION>) {
+        return 0;
+    }
+
+    // The keys of the node are sorted, so each octant is a contiguous sub-range
+    const auto first = keys.begin() + node.first_body;
+    const auto last = first + node.body_count;
+    u_int child_count = 0;
+
+    octants[0] = node.first_body;
+    for (u_int octant = 0; octant < Morton::CHILDREN<DIMENSION>; ++octant) {
+        const auto end = std::partition_point(first, last, [&](uint64_t key) {
+            return Morton::child<DIMENSION>(key, node.depth) <= octant;
+        });
+        octants[octant + 1] = static_cast<u_int>(end - keys.begin());
+        child_count += octants[octant + 1] > octants[octant] ? 1 : 0;
+    }
+
+    return child_count;
+}
+
+template <u_int DIMENSION>
+void Tree::subdivide(u_int index, const std::array<u_int, 9>& octants, u_int first_child, u_int child_count) {
+    if (child_count == 0) {
+        return;
+    }
+
+    Node& node = nodes[index];
+    const float new_half_width = node.bound.half_width * 0.5f;
+
+    node.first_child = first_child;
+
+    for (u_int octant = 0; octant < Morton::CHILDREN<DIMENSION>; ++octant) {
+        if (octants[octant + 1] == octants[octant]) {
+            continue;
+        }
+
+        // Quadtree children stay centered on the plane
+        const glm::vec3 offset(
+            (octant & 1u) != 0 ? new_half_width : -new_half_width,
+            (octant & 2u) != 0 ? new_half_width : -new_half_width,
+            DIMENSION == 2 ? 0.0f : (octant & 4u) != 0 ? new_half_width : -new_half_width
+        );
+        nodes[first_child + node.child_count] = Node(
+            Bound(node.bound.center + offset, new_half_width),
+            octants[octant],
+            octants[octant + 1] - octants[octant],
+            node.depth + 1
+        );
+        ++node.child_count;
+    }
+}
+
+void Tree::set_long_range_region(const Bound* region) {
+    regional = region != nullptr;
+    if (regional) {
+        long_range_region = *region;
+        unsplit.resize(omp_get_max_threads());
+    }
+}
+
+void Tree::calculate_center_of_mass(int multipole_degree) {
+    this->multipole_degree = multipole_degree;
+    with_jerk = false;
+    quadrupoles.resize(multipole_degree >= 2 ? nodes.size() : 0);
+    octupoles.resize(multipole_degree >= 3 ? nodes.size() : 0);
+    outside_centers.resize(regional ? nodes.size() : 0);
+    outside_masses.resize(regional ? nodes.size() : 0);
+
+    // Children are always stored on the next level, sweeping the levels deepest first is a
+    // bottom-up pass and the nodes of one level are independent of each other
+    for (size_t level = levels.size() - 1; level-- > 0;) {
+        const auto level_begin = static_cast<std::ptrdiff_t>(levels[level]);
+        const auto level_end = static_cast<std::ptrdiff_t>(levels[level + 1]);
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (std::ptrdiff_t i = level_begin; i < level_end; ++i) {
+            Node& node = nodes[i];
+            glm::vec3 center_of_mass(0.0f);
+            float total_mass = 0.0f;
+
+            if (node.is_leaf()) {
+                for (u_int j = node.first_body; j < node.first_body + node.body_count; ++j) {
+                    center_of_mass += glm::vec3(positions[0][j], positions[1][j], positions[2][j]) * masses[j];
+                    total_mass += masses[j];
+                }
+            } else {
+                for (u_int j = node.first_child; j < node.first_child + node.child_count; ++j) {
+                    center_of_mass += nodes[j].center_of_mass * nodes[j].total_mass;
+                    total_mass += nodes[j].total_mass;
+                }
+            }
+
+            // A cell of massless bodies is centered on its box, not on the origin
+            node.center_of_mass = total_mass > 0 ? center_of_mass / total_mass : node.bound.center;
+            node.total_mass = total_mass;
+
+            TraversalNode& link = traversal[i];
+            link.center_of_mass = node.center_of_mass;
+            link.total_mass = node.total_mass;
+            link.size_squared = 4.0f * node.bound.half_width * node.bound.half_width;
+            link.cell_center = node.bound.center;
+            link.half_width = node.bound.half_width;
+
+            // Monopole of the bodies outside the long range region, what a cell reaching out of
+            // it contributes past the cutoff
+            if (regional) {
+                glm::vec3 outside_center(0.0f);
+                float outside_mass = 0.0f;
+                if (node.is_leaf()) {
+                    for (u_int j = node.first_body; j < node.first_body + node.body_count; ++j) {
+                        const glm::vec3 position(positions[0][j], positions[1][j], positions[2][j]);
+                        if (!long_range_region.contains(position)) {
+                            outside_center += position * masses[j];
+                            outside_mass += masses[j];
+                        }
+                    }
+                } else {
+                    for (u_int j = node.first_child; j < node.first_child + node.child_count; ++j) {
+                        outside_center += outside_centers[j] * outside_masses[j];
+                        outside_mass += outside_masses[j];
+                    }
+                }
+                outside_centers[i] = outside_mass > 0.0f ? outside_center / outside_mass : node.center_of_mass;
+                outside_masses[i] = outside_mass;
+            }
+
+            if (multipole_degree >= 2) {
+                calculate_moments(static_cast<u_int>(i));
+            }
+        }
+    }
+
+    // With every source inside the region the split walks need no unsplit list
+    outlying = regional && !nodes.empty() && outside_masses[0] > 0.0f;
+}
+
+void Tree::calculate_velocities(const BodyStore& bodies) {
+    const auto count = static_cast<std::ptrdiff_t>(indices.size());
+    for (auto& component : velocities) {
+        component.resize(indices.size());
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            velocities[k][i] = bodies.velocity[k][indices[i]];
+        }
+    }
+
+    // Same bottom-up sweep as the centers of mass
+    cell_velocities.resize(nodes.size());
+    for (size_t level = levels.size() - 1; level-- > 0;) {
+        const auto level_begin = static_cast<std::ptrdiff_t>(levels[level]);
+        const auto level_end = static_cast<std::ptrdiff_t>(levels[level + 1]);
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (std::ptrdiff_t i = level_begin; i < level_end; ++i) {
+            const Node& node = nodes[i];
+            glm::vec3 momentum(0.0f);
+
+            if (node.is_leaf()) {
+                for (u_int j = node.first_body; j < node.first_body + node.body_count; ++j) {
+                    momentum += glm::vec3(velocities[0][j], velocities[1][j], velocities[2][j]) * masses[j];
+                }
+            } else {
+                for (u_int j = node.first_child; j < node.first_child + node.child_count; ++j) {
+                    momentum += cell_velocities[j] * nodes[j].total_mass;
+                }
+            }
+            cell_velocities[i] = node.total_mass > 0 ? momentum / node.total_mass : glm::vec3(0.0f);
+        }
+    }
+
+    with_jerk = true;
+}
+
+void Tree::calculate_moments(u_int index) {
+    const Node& node = nodes[index];
+    std::array<double, 6> quadrupole {};
+    std::array<double, 10> octupole {};
+
+    // Moments about the center of mass of the node: the bodies of a leaf directly, the moments of
+    // the children are shifted from their own centers of mass (parallel axis theorem)
+    const auto add_point = [&](const glm::vec3& offset, double mass) {
+        const double d[3] = {offset.x, offset.y, offset.z};
+        size_t q = 0;
+        size_t o = 0;
+        for (int a = 0; a < 3; ++a) {
+            for (int b = a; b < 3; ++b) {
+                quadrupole[q++] += mass * d[a] * d[b];
+                for (int c = b; c < 3; ++c) {
+                    octupole[o++] += mass * d[a] * d[b] * d[c];
+                }
+            }
+        }
+    };
+
+    if (node.is_leaf()) {
+        for (u_int j = node.first_body; j < node.first_body + node.body_count; ++j) {
+            add_point(glm::vec3(positions[0][j], positions[1][j], positions[2][j]) - node.center_of_mass, masses[j]);
+        }
+    } else {
+        for (u_int j = node.first_child; j < node.first_child + node.child_count; ++j) {
+            const glm::vec3 offset = nodes[j].center_of_mass - node.center_of_mass;
+            add_point(offset, nodes[j].total_mass);
+
+            const std::array<float, 6>& child = quadrupoles[j];
+            for (size_t k = 0; k < 6; ++k) {
+                quadrupole[k] += child[k];
+            }
+            if (multipole_degree < 3) {
+                continue;
+            }
+
+            // O_abc += O'_abc + Q'_ab d_c + Q'_ac d_b + Q'_bc d_a, with Q' the second moment
+            // of the child about its own center of mass
+            static constexpr int PAIRS[3][3] = {{0, 1, 2}, {1, 3, 4}, {2, 4, 5}};
+            const double d[3] = {offset.x, offset.y, offset.z};
+            const std::array<float, 10>& child_octupole = octupoles[j];
+            size_t o = 0;
+            for (int a = 0; a < 3; ++a) {
+                for (int b = a; b < 3; ++b) {
+                    for (int c = b; c < 3; ++c) {
+                        octupole[o] += child_octupole[o] + child[PAIRS[a][b]] * d[c] + child[PAIRS[a][c]] * d[b] + child[PAIRS[b][c]] * d[a];
+                        ++o;
+                    }
+                }
+            }
+        }
+    }
+
+    for (size_t k = 0; k < 6; ++k) {
+        quadrupoles[index][k] = static_cast<float>(quadrupole[k]);
+    }
+    if (multipole_degree >= 3) {
+        for (size_t k = 0; k < 10; ++k) {
+            octupoles[index][k] = static_cast<float>(octupole[k]);
+        }
+    }
+}
+
+// Relative criterion threshold of a walk from the smallest previous acceleration of its bodies,
+// the walk sums the kernel without gravity
+static float relative_threshold(float accuracy, float gravity, float acceleration) {
+    return gravity > 0.0f ? accuracy * acceleration / gravity : 0.0f;
+}
+
+glm::vec3 Tree::calculate_force(const BodyStore& bodies, size_t index, InteractionList& interactions, float theta, float gravity, float softening_factor, float split, Opening opening, float accuracy, glm::vec3* jerk) {
+    if (nodes.empty() || nodes[0].body_count == 0) {
+        return glm::vec3(0.0f);
+    }
+
+    // A single body is walked as a group without extent
+    const glm::vec3 position = bodies.get_position(index);
+    float threshold = 0.0f;
+    if (opening == Opening::RELATIVE) {
+        const glm::vec3 previous(bodies.acceleration[0][index], bodies.acceleration[1][index], bodies.acceleration[2][index]);
+        threshold = relative_threshold(accuracy, gravity, glm::length(previous));
+    }
+    InteractionList* outside = nullptr;
+    const float walk_split = collect_split_interactions(position, position, interactions, outside, theta, split, softening_factor * softening_factor, opening, threshold);
+
+    if (with_jerk && split == 0.0f && jerk != nullptr) {
+        const Kernel::Derivatives derivatives = evaluate_jerk(position, bodies.get_velocity(index), interactions, softening_factor * softening_factor);
+        *jerk = gravity * derivatives.jerk;
+        return gravity * derivatives.acceleration;
+    }
+    return gravity * evaluate(position, interactions, softening_factor * softening_factor, walk_split, outside);
+}
+
+void Tree::calculate_group_forces(BodyStore& bodies, std::vector<InteractionList>& interactions, float theta, float gravity, float softening_factor, float split, Opening opening, float accuracy) {
+    if (nodes.empty() || nodes[0].body_count == 0) {
+        return;
+    }
+
+    const float softening_squared = softening_factor * softening_factor;
+    const std::vector<u_int>& groups = split > 0.0f ? split_groups : leaves;
+    const auto group_count = static_cast<std::ptrdiff_t>(groups.size());
+
+    #pragma omp parallel
+    {
+        InteractionList& group_interactions = interactions[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 16)
+        for (std::ptrdiff_t g = 0; g < group_count; ++g) {
+            const Node& group = nodes[groups[g]];
+            const u_int first = group.first_body;
+            const u_int last = group.first_body + group.body_count;
+
+            glm::vec3 lower(std::numeric_limits<float>::max());
+            glm::vec3 upper(std::numeric_limits<float>::lowest());
+            float minimum_squared = std::numeric_limits<float>::max();
+            for (u_int j = first; j < last; ++j) {
+                const glm::vec3 position(positions[0][j], positions[1][j], positions[2][j]);
+                lower = glm::min(lower, position);
+                upper = glm::max(upper, position);
+
+                // The accelerations of the group are only overwritten once the group is walked
+                if (opening == Opening::RELATIVE) {
+                    const glm::vec3 previous(bodies.acceleration[0][indices[j]], bodies.acceleration[1][indices[j]], bodies.acceleration[2][indices[j]]);
+                    minimum_squared = std::min(minimum_squared, glm::dot(previous, previous));
+                }
+            }
+            const float threshold = opening == Opening::RELATIVE ? relative_threshold(accuracy, gravity, std::sqrt(minimum_squared)) : 0.0f;
+
+            // Every body of the group is evaluated against the same list
+            const u_int stride = straddles(lower, upper, split) ? 1 : last - first;
+            for (u_int begin = first; begin < last; begin += stride) {
+                const glm::vec3 single(positions[0][begin], positions[1][begin], positions[2][begin]);
+                InteractionList* outside = nullptr;
+                const float walk_split = collect_split_interactions(stride == 1 ? single : lower, stride == 1 ? single : upper, group_interactions, outside, theta, split, softening_squared, opening, threshold);
+
+                for (u_int j = begin; j < begin + stride; ++j) {
+                    const glm::vec3 position(positions[0][j], positions[1][j], positions[2][j]);
+                    if (with_jerk && split == 0.0f) {
+                        const glm::vec3 velocity(velocities[0][j], velocities[1][j], velocities[2][j]);
+                        const Kernel::Derivatives derivatives = evaluate_jerk(position, velocity, group_interactions, softening_squared);
+                        for (int k = 0; k < 3; ++k) {
+                            bodies.acceleration[k][indices[j]] = gravity * derivatives.acceleration[k];
+                            bodies.jerk[k][indices[j]] = gravity * derivatives.jerk[k];
+                        }
+                        continue;
+                    }
+
+                    const glm::vec3 acceleration = gravity * evaluate(position, group_interactions, softening_squared, walk_split, outside);
+                    for (int k = 0; k < 3; ++k) {
+                        bodies.acceleration[k][indices[j]] = acceleration[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Tree::calculate_outside_forces(BodyStore& bodies, size_t first, size_t last, std::vector<InteractionList>& interactions, float theta, float gravity, float softening_factor, float split, Opening opening, float accuracy) {
+    if (last <= first) {
+        return;
+    }
+    const auto count = static_cast<std::ptrdiff_t>(last - first);
+    if (nodes.empty() || nodes[0].body_count == 0) {
+        for (auto& component : bodies.acceleration) {
+            std::fill(component.begin() + first, component.begin() + last, 0.0f);
+        }
+        return;
+    }
+
+    outside_keys.resize(count);
+    outside_indices.resize(count);
+    #pragma omp parallel for
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        outside_keys[i] = encode(bodies.get_position(first + i), nodes[0].bound);
+        outside_indices[i] = static_cast<u_int>(first + i);
+    }
+    Morton::sort(outside_keys, outside_indices, sort_buffer);
+
+    const float softening_squared = softening_factor * softening_factor;
+    const auto group_count = static_cast<std::ptrdiff_t>((static_cast<size_t>(count) + leaf_capacity - 1) / leaf_capacity);
+
+    #pragma omp parallel
+    {
+        InteractionList& group_interactions = interactions[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 16)
+        for (std::ptrdiff_t g = 0; g < group_count; ++g) {
+            const size_t group_first = static_cast<size_t>(g) * leaf_capacity;
+            const size_t group_last = std::min(group_first + leaf_capacity, static_cast<size_t>(count));
+
+            glm::vec3 lower(std::numeric_limits<float>::max());
+            glm::vec3 upper(std::numeric_limits<float>::lowest());
+            float minimum_squared = std::numeric_limits<float>::max();
+            for (size_t j = group_first; j < group_last; ++j) {
+                const glm::vec3 position = bodies.get_position(outside_indices[j]);
+                lower = glm::min(lower, position);
+                upper = glm::max(upper, position);
+                if (opening == Opening::RELATIVE) {
+                    const u_int i = outside_indices[j];
+                    const glm::vec3 previous(bodies.acceleration[0][i], bodies.acceleration[1][i], bodies.acceleration[2][i]);
+                    minimum_squared = std::min(minimum_squared, glm::dot(previous, previous));
+                }
+            }
+            const float threshold = opening == Opening::RELATIVE ? relative_threshold(accuracy, gravity, std::sqrt(minimum_squared)) : 0.0f;
+
+            const size_t stride = straddles(lower, upper, split) ? 1 : group_last - group_first;
+            for (size_t begin = group_first; begin < group_last; begin += stride) {
+                const glm::vec3 single = bodies.get_position(outside_indices[begin]);
+                InteractionList* outside = nullptr;
+                const float walk_split = collect_split_interactions(stride == 1 ? single : lower, stride == 1 ? single : upper, group_interactions, outside, theta, split, softening_squared, opening, threshold);
+
+                for (size_t j = begin; j < begin + stride; ++j) {
+                    const u_int i = outside_indices[j];
+                    const glm::vec3 acceleration = gravity * evaluate(bodies.get_position(i), group_interactions, softening_squared, walk_split, outside);
+                    for (int k = 0; k < 3; ++k) {
+                        bodies.acceleration[k][i] = acceleration[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Tree::collect_neighborhoods(const BodyStore& bodies, size_t count, std::vector<InteractionList>& interactions, std::vector<Neighborhood>& neighborhoods, float radius) const {
+    const size_t tree_count = nodes.empty() ? 0 : nodes[0].body_count;
+    const size_t leaf_count = tree_count > 0 ? leaves.size() : 0;
+    const auto group_count = static_cast<std::ptrdiff_t>(leaf_count + count - tree_count);
+    neighborhoods.resize(group_count);
+
+    #pragma omp parallel
+    {
+        InteractionList& group_interactions = interactions[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 16)
+        for (std::ptrdiff_t g = 0; g < group_count; ++g) {
+            Neighborhood& neighborhood = neighborhoods[g];
+            neighborhood.members.clear();
+            neighborhood.neighbors.clear();
+            if (static_cast<size_t>(g) < leaf_count) {
+                const Node& leaf = nodes[leaves[g]];
+                neighborhood.members.assign(indices.begin() + leaf.first_body, indices.begin() + leaf.first_body + leaf.body_count);
+            } else {
+                neighborhood.members.push_back(static_cast<u_int>(tree_count + g - leaf_count));
+            }
+            if (tree_count == 0) {
+                continue;
+            }
+
+            glm::vec3 lower(std::numeric_limits<float>::max());
+            glm::vec3 upper(std::numeric_limits<float>::lowest());
+            for (const u_int i : neighborhood.members) {
+                const glm::vec3 position = bodies.get_position(i);
+                lower = glm::min(lower, position);
+                upper = glm::max(upper, position);
+            }
+
+            // No cell is accepted at theta 0, every leaf within the radius is opened
+            group_interactions.clear();
+            collect_interactions(lower, upper, group_interactions, 0.0f, radius, Opening::GEOMETRIC, 0.0f);
+            for (const auto& [first, range_count] : group_interactions.ranges) {
+                neighborhood.neighbors.insert(neighborhood.neighbors.end(), indices.begin() + first, indices.begin() + first + range_count);
+            }
+        }
+    }
+}
+
+glm::vec3 Tree::evaluate(const glm::vec3& position, const InteractionList& interactions, float softening_squared, float split, const InteractionList* outside) const {
+    if (split > 0.0f) {
+        glm::vec3 acceleration = Kernel::evaluate_short_range(position, interactions, softening_squared, split, dimension);
+        for (const auto& [first, count] : interactions.ranges) {
+            acceleration += Kernel::evaluate_short_range(position, positions[0].data() + first, positions[1].data() + first, positions[2].data() + first, masses.data() + first, count, softening_squared, split, dimension);
+        }
+        if (outside != nullptr) {
+            acceleration += evaluate(position, *outside, softening_squared, 0.0f);
+        }
+        return acceleration;
+    }
+
+    // The accepted cells are one packed batch, opened leaves are evaluated in place as dense tiles
+    glm::vec3 acceleration = multipole_degree >= 2 ? Kernel::evaluate_multipoles(position, interactions, softening_squared, multipole_degree, dimension)
+                                                   : Kernel::evaluate(position, interactions, softening_squared, dimension);
+    for (const auto& [first, count] : interactions.ranges) {
+        acceleration += Kernel::evaluate(position, positions[0].data() + first, positions[1].data() + first, positions[2].data() + first, masses.data() + first, count, softening_squared, dimension);
+    }
+    return acceleration;
+}
+
+Kernel::Derivatives Tree::evaluate_jerk(const glm::vec3& position, const glm::vec3& velocity, const InteractionList& interactions, float softening_squared) const {
+    Kernel::Derivatives derivatives = Kernel::evaluate_jerk(position, velocity, interactions, softening_squared);
+    for (const auto& [first, count] : interactions.ranges) {
+        derivatives += Kernel::evaluate_jerk(position, velocity, positions[0].data() + first, positions[1].data() + first, positions[2].data() + first,
+                                             velocities[0].data() + first, velocities[1].data() + first, velocities[2].data() + first, masses.data() + first, count, softening_squared);
+    }
+
+    // The higher moments of the cells still give the acceleration, the jerk is left at the monopoles
+    if (multipole_degree >= 2) {
+        derivatives.acceleration = evaluate(position, interactions, softening_squared, 0.0f);
+    }
+    return derivatives;
+}
+
+float Tree::collect_split_interactions(const glm::vec3& lower, const glm::vec3& upper, InteractionList& interactions, InteractionList*& outside, float theta, float split, float softening_squared, Opening opening, float threshold) {
+    interactions.clear();
+    outside = nullptr;
+
+    // A group outside the long range region has no long range part, it is walked unsplit
+    if (split > 0.0f && regional) {
+        if (!long_range_region.contains(lower) || !long_range_region.contains(upper)) {
+            split = 0.0f;
+        } else if (outlying) {
+            outside = &unsplit[omp_get_thread_num()];
+            outside->clear();
+        }
+    }
+
+    // A softening reaching past the cutoff leaves the short range sum negligible, the walk then
+    // only collects the group itself
+    const float cutoff = split > 0.0f ? std::max(Kernel::short_range_reach(split, softening_squared), std::numeric_limits<float>::min()) : 0.0f;
+    collect_interactions(lower, upper, interactions, theta, cutoff, opening, threshold, outside);
+    return split;
+}
+
+bool Tree::straddles(const glm::vec3& lower, const glm::vec3& upper, float split) const {
+    if (split == 0.0f || !regional) {
+        return false;
+    }
+    const glm::vec3 region_lower = long_range_region.center - long_range_region.half_width;
+    const glm::vec3 region_upper = long_range_region.center + long_range_region.half_width;
+    const bool inside = long_range_region.contains(lower) && long_range_region.contains(upper);
+    const bool apart = glm::any(glm::lessThan(upper, region_lower)) || glm::any(glm::greaterThan(lower, region_upper));
+    return !inside && !apart;
+}
+
+void Tree::collect_interactions(const glm::vec3& lower, const glm::vec3& upper, InteractionList& interactions, float theta, float cutoff, Opening opening, float threshold, InteractionList* outside) const {
+    const float theta_squared = theta * theta;
+    const float cutoff_squared = cutoff * cutoff;
+    const TraversalNode* const links = traversal.data();
+
+    const glm::vec3 center = 0.5f * (lower + upper);
+    const glm::vec3 half_extent = 0.5f * (upper - lower);
+
+    // Without a previous acceleration the relative criterion has no scale yet
+    if (opening == Opening::RELATIVE && !(threshold > 0.0f)) {
+        opening = Opening::GEOMETRIC;
+    }
+
+    // Threaded walk over the compact array, no stack and no sqrt or division per node. Cells
+    // are tested against the closest point of the group box, so the opening criterion and the
+    // cutoff hold for every body of the group.
+    u_int index = 0;
+    bool covered = false;
+    u_int covered_until = 0;
+    do {
+        const TraversalNode& link = links[index];
+        #ifdef __GNUC__
+            __builtin_prefetch(links + link.next);
+            // The first of a leaf is a body, not a node
+            if (link.body_count == 0) {
+                __builtin_prefetch(links + link.first);
+            }
+        #endif
+
+        const glm::vec3 r = glm::max(glm::abs(link.center_of_mass - center) - half_extent, glm::vec3(0.0f));
+        const float distance_squared = glm::dot(r, r);
+
+        // The cutoff is tested against the cell box, which holds every body of the cell
+        bool beyond = false;
+        if (cutoff > 0.0f) {
+            const glm::vec3 gap = glm::max(glm::abs(link.cell_center - center) - half_extent - link.half_width, glm::vec3(0.0f));
+            beyond = glm::dot(gap, gap) > cutoff_squared;
+        }
+
+        // Cells wholly outside the long range region go to the unsplit list without a cutoff. The
+        // bodies outside it of a cell reaching across its faces are one more cell for the opening
+        // criterion, their monopole is accepted on its own and the cell is then only followed
+        // for its bodies inside the region. Until the walk leaves that cell its outside bodies
+        // are summed already.
+        InteractionList* list = &interactions;
+        if (outside != nullptr) {
+            if (covered && index == covered_until) {
+                covered = false;
+            }
+            const glm::vec3 offset = glm::abs(link.cell_center - long_range_region.center);
+            const glm::vec3 region_half_width(long_range_region.half_width);
+            if (glm::any(glm::greaterThan(offset - link.half_width, region_half_width))) {
+                if (covered) {
+                    index = link.next;
+                    continue;
+                }
+                list = outside;
+            } else if (outside_masses[index] > 0.0f && glm::any(glm::greaterThan(offset + link.half_width, region_half_width))) {
+                if (!covered) {
+                    const glm::vec3 reach = glm::max(glm::abs(outside_centers[index] - center) - half_extent, glm::vec3(0.0f));
+                    if (link.size_squared < theta_squared * glm::dot(reach, reach)) {
+                        outside->push(outside_centers[index], outside_masses[index]);
+                        covered = true;
+                        covered_until = link.next;
+                    }
+                }
+                if (link.body_count != 0) {
+                    for (u_int b = link.first; b < link.first + link.body_count; ++b) {
+                        const glm::vec3 position(positions[0][b], positions[1][b], positions[2][b]);
+                        if (!long_range_region.contains(position)) {
+                            if (!covered) {
+                                outside->push(position, masses[b]);
+                            }
+                        } else if (!beyond) {
+                            interactions.push(position, masses[b]);
+                        }
+                    }
+                }
+                index = link.body_count != 0 || (covered && beyond) ? link.next : link.first;
+                continue;
+            }
+        }
+
+        if (beyond && list == &interactions) {
+            index = link.next;
+            continue;
+        }
+
+        bool accepted = false;
+        switch (opening) {
+            case Opening::GEOMETRIC:
+                accepted = link.size_squared < theta_squared * distance_squared;
+                break;
+            case Opening::BMAX: {
+                const glm::vec3 corner = glm::abs(link.center_of_mass - link.cell_center) + link.half_width;
+                accepted = glm::dot(corner, corner) < theta_squared * distance_squared;
+                break;
+            }
+            case Opening::BOX: {
+                const glm::vec3 gap = glm::max(glm::abs(link.cell_center - center) - half_extent - link.half_width, glm::vec3(0.0f));
+                accepted = link.size_squared < theta_squared * glm::dot(gap, gap);
+                break;
+            }
+            case Opening::RELATIVE: {
+                const glm::vec3 margin = glm::abs(link.cell_center - center) - half_extent - 1.2f * link.half_width;
+                const bool apart = margin.x > 0.0f || margin.y > 0.0f || margin.z > 0.0f;
+                accepted = apart && link.total_mass * link.size_squared < threshold * distance_squared * distance_squared;
+                break;
+            }
+        }
+
+        if (accepted) {
+            list->push(link.center_of_mass, link.total_mass);
+            if (with_jerk) {
+                list->push_velocity(cell_velocities[index]);
+            }
+            if (multipole_degree >= 2) {
+                list->push_moments(quadrupoles[index].data(), multipole_degree >= 3 ? octupoles[index].data() : nullptr);
+            }
+        } else if (link.body_count != 0) {
+            // The bodies of the group are part of their own leaf, the kernel gives them no self
+            // contribution. The few leaves within the cutoff are copied, so that every body of
+            // the group is one call of the kernel instead of one per leaf.
+            if (cutoff > 0.0f) {
+                list->append(positions[0].data() + link.first, positions[1].data() + link.first, positions[2].data() + link.first, masses.data() + link.first, link.body_count);
+            } else {
+                list->ranges.emplace_back(link.first, link.body_count);
+            }
+        }
+        index = accepted || link.body_count != 0 ? link.next : link.first;
+    } while (index != 0);
+}
+
+u_int Tree::find_nearest(const glm::vec3& position, u_int excluded, float radius) const {
+    if (nodes.empty() || nodes[0].body_count == 0) {
+        return NO_BODY;
+    }
+
+    const TraversalNode* const links = traversal.data();
+    float nearest_squared = radius * radius;
+    u_int nearest = NO_BODY;
+
+    u_int index = 0;
+    do {
+        const TraversalNode& link = links[index];
+        const glm::vec3 gap = glm::max(glm::abs(link.cell_center - position) - link.half_width, glm::vec3(0.0f));
+
+        if (glm::dot(gap, gap) > nearest_squared) {
+            index = link.next;
+            continue;
+        }
+        if (link.body_count != 0) {
+            for (u_int b = link.first; b < link.first + link.body_count; ++b) {
+                const glm::vec3 offset = glm::vec3(positions[0][b], positions[1][b], positions[2][b]) - position;
+                const float distance_squared = glm::dot(offset, offset);
+                if (indices[b] != excluded && distance_squared < nearest_squared) {
+                    nearest_squared = distance_squared;
+                    nearest = indices[b];
+                }
+            }
+        }
+        index = link.body_count != 0 ? link.next : link.first;
+    } while (index != 0);
+
+    return nearest;
+}
+
+const Arena<Node>& Tree::get_nodes() const {
+    return nodes;
+}
+
+const std::vector<u_int>& Tree::get_levels() const {
+    return levels;
+}
+
+const std::vector<u_int>& Tree::get_indices() const {
+    return indices;
+}
+
+const std::array<aligned_vector<float>, 3>& Tree::get_positions() const {
+    return positions;
+}
+
+const aligned_vector<float>& Tree::get_masses() const {
+    return masses;
 }
 
-void Tree::calculate_center_of_mass() {
-    root.calculate_center_of_mass();
+size_t Tree::get_body_count() const {
+    return indices.size();
 }
 
-void Tree::calculate_force(Body& body, float theta, float gravity, const double softening_factor) const {
-    root.calculate_force(body, theta, gravity, softening_factor);
+u_int Tree::get_dimension() const {
+    return dimension;
 }
@@ -46,5 +46,23 @@ void Scene::simulate() {
     if (n_body != nullptr) {
         delete n_body;
     }
-    n_body = new BarnesHut(10000);
+    n_body = create(solver, 10000);
+}
+
+NBody* Scene::create(Solver solver, int body_count) {
+    switch (solver) {
+        case Solver::FMM:
+            return new FMM(body_count);
+        case Solver::DIRECT_SUM:
+            return new DirectSum(body_count);
+        case Solver::PARTICLE_MESH:
+            return new ParticleMesh(body_count);
+        case Solver::TREE_PM:
+            return new TreePM(body_count);
+        case Solver::PLANETARY:
+            return new Planetary(body_count);
+        case Solver::BARNES_HUT:
+        default:
+            return new BarnesHut(body_count);
+    }
 }
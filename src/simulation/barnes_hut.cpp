@@ -3,167 +3,158 @@
  * @file barnes_hut.cpp
 */
 
-#include <random>
-#include <iostream>
 #include <omp.h>
 #include "simulation/barnes_hut.hpp"
 
-const char* const BarnesHut::vertex_shader = 
-    R"(
-        #version 300 es
-        precision highp float;
-        layout(location = 0) in vec3 a_position;
-        layout(location = 1) in vec3 a_velocity;
-        layout(location = 2) in vec3 a_color;
-
-        uniform mat4 u_view_projection;
-        out vec3 v_color;
-
-        void main(void) {
-            gl_Position = u_view_projection * vec4(a_position, 1.0);
-            v_color = a_color;
-            gl_PointSize = 2.0f;
-        }
-    )";
-
-const char* const BarnesHut::fragment_shader = 
-    R"(
-        #version 300 es
-        precision highp float;
-        in vec3 v_color;
-        out vec4 frag_color;
+BarnesHut::BarnesHut(int bodies_count) {
+    // Resize the body store
+    set_body_count(bodies_count);
+}
 
-        void main(void) {
-            frag_color = vec4(v_color, 1.0f);
-        }
-    )";
-
-BarnesHut::BarnesHut(int bodies_count) :
-    shader(vertex_shader, fragment_shader, false) {
-        // Resize the bodies vector
-        set_body_count(bodies_count);
-
-        // Generate the VAO and VBO
-        glGenVertexArrays(1, &vao);
-        glGenBuffers(1, &vbo);
-
-        // Bind the VAO and VBO
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizei>(bodies.size() * sizeof(Body)), bodies.data(), GL_DYNAMIC_DRAW);
-
-        // Set the vertex attributes
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Body), (void*)offsetof(Body, position));
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Body), (void*)offsetof(Body, velocity));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Body), (void*)offsetof(Body, color));
-        glEnableVertexAttribArray(2);
-
-        // Unbind the VAO and VBO
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
+void BarnesHut::calculate_forces() {
+    calculate_tree_forces();
+}
 
-BarnesHut::~BarnesHut() {
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
+bool BarnesHut::has_active_forces() const {
+    return true;
 }
 
-void BarnesHut::update(const float& delta_time) {
-    // Create the octree with appropriate bounds
-    Tree octree(Bound(glm::vec3(0.0f), 10.0f));
+void BarnesHut::calculate_active_forces(const std::vector<u_int>& active) {
+    calculate_tree_forces(0.0f, &active);
+}
 
-    const size_t interaction_count = static_cast<size_t>(bodies.size() * interaction_percentage);
+void BarnesHut::find_close_pairs(float radius, std::vector<Encounter>& pairs) {
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    nearest.resize(bodies.size());
 
-    // Update the octree with bodies using OpenMP
-    #pragma omp parallel for
-    for (size_t i = 0; i < interaction_count; i++) {
-        octree.insert(&bodies[i]);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        nearest[i] = octree.find_nearest(bodies.get_position(i), static_cast<u_int>(i), radius);
     }
 
-    // Calculate center of mass for the octree
-    octree.calculate_center_of_mass();
-
-    // Calculate forces and update positions/velocities for each body
-    #pragma omp parallel for
-    for (auto& body : bodies) {
-        // Calculate forces using the octree
-        octree.calculate_force(body, theta, gravity, softening_factor);
-        
-        // Integrate forces to update position and velocity
-        const glm::vec3 acceleration = body.forces / body.mass;
-        body.position += body.velocity * delta_time + 0.5f * acceleration * delta_time * delta_time;
-        body.velocity += acceleration * delta_time;
-        body.velocity *= damping;
-        body.forces = glm::vec3(0.0f); // Reset forces for next iteration
+    pairs.clear();
+    for (u_int i = 0; i < static_cast<u_int>(count); ++i) {
+        const u_int j = nearest[i];
+        if (j != Tree::NO_BODY && i < j && nearest[j] == i) {
+            pairs.push_back({i, j});
+        }
     }
 }
 
-void BarnesHut::render(glm::mat4 view, glm::mat4 view_projection) {
-    // Bind the vertex array and buffer
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-    // Update the VBO data
-    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizei>(bodies.size() * sizeof(Body)), bodies.data(), GL_DYNAMIC_DRAW);
-
-    // Use the shader
-    shader.use();
-    shader.set_mat4("u_view_projection", view * view_projection);
+void BarnesHut::calculate_far_forces(std::array<aligned_vector<float>, 3>& far) {
+    calculate_tree_forces();
+    for (int k = 0; k < 3; ++k) {
+        far[k].assign(bodies.acceleration[k].begin(), bodies.acceleration[k].end());
+    }
 
-    // Draw the bodies
-    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(bodies.size()));
+    // The lists reach past the cutoff so that they still hold the bodies coming closer until
+    // the next far pass
+    octree.collect_neighborhoods(bodies, bodies.size(), interactions, neighborhoods, NEIGHBOR_REACH * Kernel::SHORT_RANGE_CUTOFF * near_field_scale);
+    calculate_near_forces();
 
-    // Unbind the vertex array and buffer
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
+    // The far field is the smooth rest of the walk
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    for (int k = 0; k < 3; ++k) {
+        float* far_acceleration = far[k].data();
+        const float* near_acceleration = bodies.acceleration[k].data();
 
-void BarnesHut::reset() {
-    randomize();
-}
-
-void BarnesHut::randomize() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> random_angle(0.0f, static_cast<float>(2.0 * M_PI));
-    std::uniform_real_distribution<float> random_color(0.0f, 1.0f);
-    std::uniform_real_distribution<float> random_radius(1.5f, 3.0f); // Adjust as per your simulation space
-
-    // Initialize the bodies using OpenMP
-    #pragma omp parallel for
-    for (size_t i = 0; i < bodies.size(); i++) {
-        auto& body = bodies[i];
-        const float phi = random_angle(gen);
-        const float theta = random_angle(gen);
-        const float rad = random_radius(gen); // Adjust radius range as per your simulation space
-        const float x = rad * std::cos(phi) * std::sin(theta);
-        const float y = rad * std::sin(phi) * std::sin(theta);
-        const float z = rad * std::cos(theta);
-        body.position = glm::vec3(x, y, z);
-        body.velocity = glm::vec3(0.0f, 0.0f, 0.0f);
-        body.color = glm::vec3(random_color(gen), random_color(gen), random_color(gen));
-        body.mass = mass;
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; ++i) {
+            far_acceleration[i] -= near_acceleration[i];
+        }
     }
 }
 
-void BarnesHut::clear() {
-    bodies.clear();
+void BarnesHut::calculate_near_forces() {
+    const float softening_squared = softening_factor * softening_factor;
+    const auto group_count = static_cast<std::ptrdiff_t>(neighborhoods.size());
+    interactions.resize(omp_get_max_threads());
+
+    // The neighbors of the last far pass are gathered where they are now and summed directly
+    // with the erfc weighted short range kernel
+    #pragma omp parallel
+    {
+        InteractionList& neighbors = interactions[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 16)
+        for (std::ptrdiff_t g = 0; g < group_count; ++g) {
+            const Tree::Neighborhood& neighborhood = neighborhoods[g];
+            neighbors.clear();
+            for (const u_int j : neighborhood.neighbors) {
+                neighbors.push(bodies.get_position(j), bodies.mass[j]);
+            }
+
+            for (const u_int i : neighborhood.members) {
+                const glm::vec3 acceleration = gravity * Kernel::evaluate_short_range(bodies.get_position(i), neighbors, softening_squared, near_field_scale, dimension);
+                for (int k = 0; k < 3; ++k) {
+                    bodies.acceleration[k][i] = acceleration[k];
+                }
+            }
+        }
+    }
 }
 
-size_t BarnesHut::get_body_count() const {
-    return bodies.size();
-}
+void BarnesHut::calculate_tree_forces(float split, const std::vector<u_int>* active, const Bound* region) {
+    // Tracers and the bodies past the interaction percentage are left out of the tree
+    const size_t interaction_count = get_source_count();
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+
+    // The tree is refit from every body, those between their steps are predicted to the tick
+    predict_positions();
+
+    // Between rebuilds only the node bounds are refitted to the moved bodies. The passes of the
+    // block steps over some of the bodies always refit, the tree then follows the bodies that
+    // only drifted, and it is rebuilt by the full pass of the frame step.
+    const bool reusable = octree.get_body_count() == interaction_count && octree.get_dimension() == dimension;
+    const bool refitted = reusable && (active != nullptr || ++steps_since_build < refit_interval) && octree.refit(bodies);
+
+    if (!refitted) {
+        // Fit the root cell to the bodies, then build the linear octree from the Morton sorted bodies
+        bound = bound.follow(Bound::enclosing(bodies, interaction_count), bound_hysteresis);
+        octree.build(bodies, interaction_count, bound, static_cast<u_int>(leaf_capacity), dimension);
+        steps_since_build = 0;
+    }
 
-void BarnesHut::set_body_count(const size_t& body_count) {
-    clear();
+    // Calculate center of mass for the octree, the short range kernel only uses the monopoles
+    octree.set_long_range_region(split > 0.0f ? region : nullptr);
+    octree.calculate_center_of_mass(split > 0.0f ? 0 : multipole_degree);
+    const bool with_jerk = integrator == Integrator::HERMITE && split == 0.0f;
+    if (with_jerk) {
+        octree.calculate_velocities(bodies);
+    }
 
-    #pragma omp parallel for
-    for (int i = 0; i < body_count; i++) {
-        bodies.emplace_back(i);
+    // Calculate the acceleration of each body using the octree, bodies in the tree can share one
+    // walk per leaf, tracers and the other bodies outside it one walk per run along the Morton
+    // curve. Active bodies are scattered over the leaves, each of them walks the tree on its own,
+    // and so does every body outside the tree when the jerk is needed.
+    interactions.resize(omp_get_max_threads());
+    const bool grouped = group_walk && active == nullptr;
+    const bool outside_grouped = grouped && !with_jerk;
+    const auto walked = grouped ? static_cast<std::ptrdiff_t>(outside_grouped ? count : interaction_count) : 0;
+    const auto targets = active != nullptr ? static_cast<std::ptrdiff_t>(active->size()) : count;
+
+    if (grouped) {
+        octree.calculate_group_forces(bodies, interactions, theta, gravity, softening_factor, split, opening, force_accuracy);
+    }
+    if (outside_grouped) {
+        octree.calculate_outside_forces(bodies, interaction_count, bodies.size(), interactions, theta, gravity, softening_factor, split, opening, force_accuracy);
     }
 
-    randomize();
+    #pragma omp parallel
+    {
+        InteractionList& thread_interactions = interactions[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 256)
+        for (std::ptrdiff_t target = walked; target < targets; target++) {
+            const std::ptrdiff_t i = active != nullptr ? static_cast<std::ptrdiff_t>((*active)[target]) : target;
+            glm::vec3 jerk(0.0f);
+            const glm::vec3 acceleration = octree.calculate_force(bodies, i, thread_interactions, theta, gravity, softening_factor, split, opening, force_accuracy, with_jerk ? &jerk : nullptr);
+            for (int k = 0; k < 3; ++k) {
+                bodies.acceleration[k][i] = acceleration[k];
+                if (with_jerk) {
+                    bodies.jerk[k][i] = jerk[k];
+                }
+            }
+        }
+    }
 }
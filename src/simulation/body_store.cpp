@@ -0,0 +1,46 @@
+/*
+ * @path src/simulation/body_store.cpp
+ * @file body_store.cpp
+*/
+
+#include <numeric>
+#include "simulation/body_store.hpp"
+
+void BodyStore::resize(size_t count) {
+    for (int k = 0; k < 3; ++k) {
+        position[k].resize(count, 0.0f);
+        velocity[k].resize(count, 0.0f);
+        acceleration[k].resize(count, 0.0f);
+        jerk[k].resize(count, 0.0f);
+    }
+    mass.resize(count, 1.0f);
+    color.resize(count, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    const size_t previous = id.size();
+    id.resize(count);
+    std::iota(id.begin() + static_cast<std::ptrdiff_t>(std::min(previous, count)), id.end(), static_cast<u_int>(std::min(previous, count)));
+}
+
+void BodyStore::clear() {
+    for (int k = 0; k < 3; ++k) {
+        position[k].clear();
+        velocity[k].clear();
+        acceleration[k].clear();
+        jerk[k].clear();
+    }
+    mass.clear();
+    color.clear();
+    id.clear();
+}
+
+size_t BodyStore::size() const {
+    return mass.size();
+}
+
+glm::vec3 BodyStore::get_position(size_t index) const {
+    return {position[0][index], position[1][index], position[2][index]};
+}
+
+glm::vec3 BodyStore::get_velocity(size_t index) const {
+    return {velocity[0][index], velocity[1][index], velocity[2][index]};
+}
@@ -3,14 +3,57 @@
  * @file bound.cpp
 */
 
+#include <algorithm>
+#include <limits>
 #include "simulation/bound.hpp"
 
+Bound::Bound() : center(0.0f), half_width(0.0f) {}
+
 Bound::Bound(glm::vec3 center, float half_width)
     : center(center), half_width(half_width) {}
 
 
-bool Bound::contains(const Body& body) const {
-    return body.position.x >= center.x - half_width && body.position.x <= center.x + half_width &&
-           body.position.y >= center.y - half_width && body.position.y <= center.y + half_width &&
-           body.position.z >= center.z - half_width && body.position.z <= center.z + half_width;
+bool Bound::contains(const glm::vec3& position) const {
+    return position.x >= center.x - half_width && position.x <= center.x + half_width &&
+           position.y >= center.y - half_width && position.y <= center.y + half_width &&
+           position.z >= center.z - half_width && position.z <= center.z + half_width;
+}
+
+bool Bound::contains(const Bound& other) const {
+    return glm::all(glm::lessThanEqual(glm::abs(other.center - center) + other.half_width, glm::vec3(half_width)));
+}
+
+Bound Bound::enclosing(const BodyStore& bodies, size_t count) {
+    glm::vec3 lower(0.0f), upper(0.0f);
+
+    // One min/max reduction per component array, each of them vectorizes
+    for (int k = 0; k < 3; ++k) {
+        const float* position = bodies.position[k].data();
+        float minimum = std::numeric_limits<float>::max();
+        float maximum = std::numeric_limits<float>::lowest();
+
+        #pragma omp parallel for simd reduction(min:minimum) reduction(max:maximum)
+        for (size_t i = 0; i < count; ++i) {
+            minimum = std::min(minimum, position[i]);
+            maximum = std::max(maximum, position[i]);
+        }
+
+        if (count > 0) {
+            lower[k] = minimum;
+            upper[k] = maximum;
+        }
+    }
+
+    const glm::vec3 extent = upper - lower;
+    // Keep a non degenerate cube for a single body or bodies sharing one position
+    const float half_width = std::max(0.5f * std::max({extent.x, extent.y, extent.z}), 1e-3f);
+    return {0.5f * (lower + upper), half_width};
+}
+
+Bound Bound::follow(const Bound& fitted, float hysteresis) const {
+    const float slack = 1.0f + std::max(hysteresis, 0.0f);
+    if (contains(fitted) && half_width <= fitted.half_width * slack * slack) {
+        return *this;
+    }
+    return {fitted.center, fitted.half_width * slack};
 }
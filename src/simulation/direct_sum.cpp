@@ -0,0 +1,142 @@
+/*
+ * @path src/simulation/direct_sum.cpp
+ * @file direct_sum.cpp
+*/
+
+#include <algorithm>
+#include <omp.h>
+#include "simulation/direct_sum.hpp"
+#include "simulation/kernel.hpp"
+
+DirectSum::DirectSum(int bodies_count) {
+    // Resize the body store
+    set_body_count(bodies_count);
+}
+
+void DirectSum::calculate_forces() {
+    const size_t count = bodies.size();
+    const float softening_squared = softening_factor * softening_factor;
+
+    // Only the first bodies source gravity, like the bodies inserted in the tree
+    const size_t sources = get_source_count();
+
+    // The pair kernel has no jerk, the Hermite integrator always takes the plain sum
+    if (symmetric_pairs && integrator != Integrator::HERMITE) {
+        evaluate_symmetric(sources, softening_squared);
+        evaluate(sources, count, sources, softening_squared);
+    } else {
+        evaluate(0, count, sources, softening_squared);
+    }
+}
+
+bool DirectSum::has_active_forces() const {
+    return true;
+}
+
+void DirectSum::calculate_active_forces(const std::vector<u_int>& active) {
+    predict_positions();
+    evaluate(0, active.size(), get_source_count(), softening_factor * softening_factor, &active);
+}
+
+void DirectSum::evaluate(size_t begin, size_t end, size_t sources, float softening_squared, const std::vector<u_int>* active) {
+    const auto block_count = static_cast<std::ptrdiff_t>((end - begin + BLOCK - 1) / BLOCK);
+    const float* x = bodies.position[0].data();
+    const float* y = bodies.position[1].data();
+    const float* z = bodies.position[2].data();
+    const float* mass = bodies.mass.data();
+    const float* vx = bodies.velocity[0].data();
+    const float* vy = bodies.velocity[1].data();
+    const float* vz = bodies.velocity[2].data();
+    const bool with_jerk = integrator == Integrator::HERMITE;
+
+    // Every task owns a block of targets and streams the sources through it one tile at a time
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t block = 0; block < block_count; ++block) {
+        const size_t first = begin + static_cast<size_t>(block) * BLOCK;
+        const size_t last = std::min(first + BLOCK, end);
+        std::array<Kernel::Derivatives, BLOCK> derivatives {};
+
+        for (size_t tile = 0; tile < sources; tile += TILE) {
+            const size_t tile_size = std::min(TILE, sources - tile);
+            for (size_t n = first; n < last; ++n) {
+                const size_t i = active != nullptr ? (*active)[n] : n;
+                if (with_jerk) {
+                    derivatives[n - first] += Kernel::evaluate_jerk(bodies.get_position(i), bodies.get_velocity(i), x + tile, y + tile, z + tile, vx + tile, vy + tile, vz + tile, mass + tile, tile_size, softening_squared);
+                } else {
+                    derivatives[n - first].acceleration += Kernel::evaluate(bodies.get_position(i), x + tile, y + tile, z + tile, mass + tile, tile_size, softening_squared, dimension);
+                }
+            }
+        }
+
+        for (size_t n = first; n < last; ++n) {
+            const size_t i = active != nullptr ? (*active)[n] : n;
+            for (int k = 0; k < 3; ++k) {
+                bodies.acceleration[k][i] = gravity * derivatives[n - first].acceleration[k];
+                if (with_jerk) {
+                    bodies.jerk[k][i] = gravity * derivatives[n - first].jerk[k];
+                }
+            }
+        }
+    }
+}
+
+void DirectSum::evaluate_symmetric(size_t sources, float softening_squared) {
+    const auto thread_count = static_cast<size_t>(omp_get_max_threads());
+    thread_accelerations.resize(thread_count);
+
+    // Pairs of blocks on and above the diagonal, each one evaluated once for both sides
+    const size_t block_count = (sources + BLOCK - 1) / BLOCK;
+    tiles.clear();
+    for (size_t i = 0; i < block_count; ++i) {
+        for (size_t j = i; j < block_count; ++j) {
+            tiles.emplace_back(i, j);
+        }
+    }
+
+    const float* x = bodies.position[0].data();
+    const float* y = bodies.position[1].data();
+    const float* z = bodies.position[2].data();
+    const float* mass = bodies.mass.data();
+    const auto tile_count = static_cast<std::ptrdiff_t>(tiles.size());
+
+    #pragma omp parallel
+    {
+        const auto team = static_cast<size_t>(omp_get_num_threads());
+        auto& accelerations = thread_accelerations[omp_get_thread_num()];
+        for (auto& component : accelerations) {
+            component.assign(sources, 0.0f);
+        }
+        float* ax = accelerations[0].data();
+        float* ay = accelerations[1].data();
+        float* az = accelerations[2].data();
+
+        #pragma omp for schedule(dynamic, 4)
+        for (std::ptrdiff_t t = 0; t < tile_count; ++t) {
+            const auto [block_i, block_j] = tiles[t];
+            const size_t first_i = block_i * BLOCK;
+            const size_t last_i = std::min(first_i + BLOCK, sources);
+            const size_t last_j = std::min(block_j * BLOCK + BLOCK, sources);
+
+            for (size_t i = first_i; i < last_i; ++i) {
+                // Within the diagonal block only the pairs above the diagonal are visited
+                const size_t first_j = block_i == block_j ? i + 1 : block_j * BLOCK;
+                const glm::vec3 acceleration = Kernel::evaluate_pairs(bodies.get_position(i), mass[i], x + first_j, y + first_j, z + first_j, mass + first_j, ax + first_j, ay + first_j, az + first_j, last_j - first_j, softening_squared, dimension);
+                ax[i] += acceleration.x;
+                ay[i] += acceleration.y;
+                az[i] += acceleration.z;
+            }
+        }
+
+        // Reduce the thread buffers, every thread sums a slice of the bodies
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(sources); ++i) {
+            for (int k = 0; k < 3; ++k) {
+                float sum = 0.0f;
+                for (size_t thread = 0; thread < team; ++thread) {
+                    sum += thread_accelerations[thread][k][i];
+                }
+                bodies.acceleration[k][i] = gravity * sum;
+            }
+        }
+    }
+}
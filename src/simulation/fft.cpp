@@ -0,0 +1,246 @@
+/*
+ * @path src/simulation/fft.cpp
+ * @file fft.cpp
+*/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <omp.h>
+#include "simulation/fft.hpp"
+
+// Bit reversal permutation of a power of two length
+static std::vector<u_int> bit_reversal(size_t length) {
+    std::vector<u_int> result(length, 0);
+    for (size_t i = 1, j = 0; i < length; ++i) {
+        size_t bit = length >> 1;
+        for (; (j & bit) != 0; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        result[i] = static_cast<u_int>(j);
+    }
+    return result;
+}
+
+void FFT::prepare(size_t size) {
+    if (size == this->size) {
+        return;
+    }
+    this->size = size;
+
+    twiddles_real.resize(size / 2);
+    twiddles_imaginary.resize(size / 2);
+    for (size_t k = 0; k < size / 2; ++k) {
+        const double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+        twiddles_real[k] = static_cast<float>(std::cos(angle));
+        twiddles_imaginary[k] = static_cast<float>(std::sin(angle));
+    }
+    reversal = bit_reversal(size);
+    half_reversal = bit_reversal(size / 2);
+}
+
+size_t FFT::get_size() const {
+    return size;
+}
+
+size_t FFT::get_half_size() const {
+    return size / 2 + 1;
+}
+
+void FFT::transform(float* real, float* imaginary, bool backward, bool half) const {
+    const size_t length = half ? size / 2 : size;
+    const std::vector<u_int>& permutation = half ? half_reversal : reversal;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (i < permutation[i]) {
+            std::swap_ranges(real + i * BLOCK, real + (i + 1) * BLOCK, real + permutation[i] * BLOCK);
+            std::swap_ranges(imaginary + i * BLOCK, imaginary + (i + 1) * BLOCK, imaginary + permutation[i] * BLOCK);
+        }
+    }
+
+    // Iterative decimation in time, the twiddles of a span are every size / span th of the table
+    const float sign = backward ? -1.0f : 1.0f;
+    for (size_t span = 2; span <= length; span <<= 1) {
+        const size_t step = size / span;
+        const size_t middle = span / 2;
+        for (size_t first = 0; first < length; first += span) {
+            for (size_t j = 0; j < middle; ++j) {
+                const float twiddle_real = twiddles_real[j * step];
+                const float twiddle_imaginary = sign * twiddles_imaginary[j * step];
+                float* even_real = real + (first + j) * BLOCK;
+                float* even_imaginary = imaginary + (first + j) * BLOCK;
+                float* odd_real = real + (first + j + middle) * BLOCK;
+                float* odd_imaginary = imaginary + (first + j + middle) * BLOCK;
+
+                #pragma omp simd
+                for (size_t b = 0; b < BLOCK; ++b) {
+                    const float product_real = odd_real[b] * twiddle_real - odd_imaginary[b] * twiddle_imaginary;
+                    const float product_imaginary = odd_real[b] * twiddle_imaginary + odd_imaginary[b] * twiddle_real;
+                    odd_real[b] = even_real[b] - product_real;
+                    odd_imaginary[b] = even_imaginary[b] - product_imaginary;
+                    even_real[b] += product_real;
+                    even_imaginary[b] += product_imaginary;
+                }
+            }
+        }
+    }
+}
+
+void FFT::transform_axis(Complex* data, size_t outer_count, size_t outer_stride, size_t stride, bool backward) {
+    const size_t half_size = get_half_size();
+    const size_t block_count = (half_size + BLOCK - 1) / BLOCK;
+    const auto tasks = static_cast<std::ptrdiff_t>(outer_count * block_count);
+    buffers.resize(omp_get_max_threads());
+
+    #pragma omp parallel
+    {
+        aligned_vector<float>& buffer = buffers[omp_get_thread_num()];
+        buffer.resize(2 * BLOCK * size);
+        float* real = buffer.data();
+        float* imaginary = buffer.data() + BLOCK * size;
+
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t task = 0; task < tasks; ++task) {
+            const size_t outer = static_cast<size_t>(task) / block_count;
+            const size_t first = (static_cast<size_t>(task) % block_count) * BLOCK;
+            const size_t width = std::min(BLOCK, half_size - first);
+            Complex* base = data + outer * outer_stride + first;
+
+            // Consecutive lines are adjacent in memory, the block is gathered value by value
+            for (size_t j = 0; j < size; ++j) {
+                for (size_t b = 0; b < BLOCK; ++b) {
+                    const Complex value = b < width ? base[j * stride + b] : Complex(0.0f);
+                    real[j * BLOCK + b] = value.real();
+                    imaginary[j * BLOCK + b] = value.imag();
+                }
+            }
+            transform(real, imaginary, backward, false);
+            for (size_t j = 0; j < size; ++j) {
+                for (size_t b = 0; b < width; ++b) {
+                    base[j * stride + b] = Complex(real[j * BLOCK + b], imaginary[j * BLOCK + b]);
+                }
+            }
+        }
+    }
+}
+
+void FFT::forward(const float* real, Complex* spectrum, size_t extent) {
+    const size_t half_size = get_half_size();
+    const size_t middle = size / 2;
+    const size_t lines = size * size;
+    const auto blocks = static_cast<std::ptrdiff_t>((lines + BLOCK - 1) / BLOCK);
+    buffers.resize(omp_get_max_threads());
+
+    // Real lines along z, the even and odd values are packed in one complex line of half the length
+    #pragma omp parallel
+    {
+        aligned_vector<float>& buffer = buffers[omp_get_thread_num()];
+        buffer.resize(2 * BLOCK * size);
+        float* packed_real = buffer.data();
+        float* packed_imaginary = buffer.data() + BLOCK * size;
+
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t block = 0; block < blocks; ++block) {
+            std::array<bool, BLOCK> active {};
+            for (size_t b = 0; b < BLOCK; ++b) {
+                const size_t line = static_cast<size_t>(block) * BLOCK + b;
+                active[b] = line < lines && line / size < extent && line % size < extent;
+                if (line < lines && !active[b]) {
+                    std::fill(spectrum + line * half_size, spectrum + (line + 1) * half_size, Complex(0.0f));
+                }
+            }
+            if (std::none_of(active.begin(), active.end(), [](bool value) { return value; })) {
+                continue;
+            }
+
+            for (size_t b = 0; b < BLOCK; ++b) {
+                const float* values = real + (static_cast<size_t>(block) * BLOCK + b) * size;
+                for (size_t m = 0; m < middle; ++m) {
+                    packed_real[m * BLOCK + b] = active[b] ? values[2 * m] : 0.0f;
+                    packed_imaginary[m * BLOCK + b] = active[b] ? values[2 * m + 1] : 0.0f;
+                }
+            }
+            transform(packed_real, packed_imaginary, false, true);
+
+            // Separate the spectra of the even and odd values and combine them
+            for (size_t b = 0; b < BLOCK; ++b) {
+                if (!active[b]) {
+                    continue;
+                }
+                Complex* coefficients = spectrum + (static_cast<size_t>(block) * BLOCK + b) * half_size;
+                for (size_t k = 0; k <= middle; ++k) {
+                    const size_t direct = (k % middle) * BLOCK + b;
+                    const size_t mirrored = ((middle - k) % middle) * BLOCK + b;
+                    const float sum_real = 0.5f * (packed_real[direct] + packed_real[mirrored]);
+                    const float sum_imaginary = 0.5f * (packed_imaginary[direct] - packed_imaginary[mirrored]);
+                    // odd = -i (packed - conj(mirrored)) / 2
+                    const float odd_real = 0.5f * (packed_imaginary[direct] + packed_imaginary[mirrored]);
+                    const float odd_imaginary = -0.5f * (packed_real[direct] - packed_real[mirrored]);
+                    const float twiddle_real = k < middle ? twiddles_real[k] : -1.0f;
+                    const float twiddle_imaginary = k < middle ? twiddles_imaginary[k] : 0.0f;
+                    coefficients[k] = Complex(sum_real + twiddle_real * odd_real - twiddle_imaginary * odd_imaginary,
+                                              sum_imaginary + twiddle_real * odd_imaginary + twiddle_imaginary * odd_real);
+                }
+            }
+        }
+    }
+
+    // Along y only the planes holding values are transformed, along x every line
+    transform_axis(spectrum, extent, size * half_size, half_size, false);
+    transform_axis(spectrum, size, half_size, size * half_size, false);
+}
+
+void FFT::inverse(Complex* spectrum, float* real, size_t extent) {
+    const size_t half_size = get_half_size();
+    const size_t middle = size / 2;
+    const size_t lines = extent * extent;
+    const auto blocks = static_cast<std::ptrdiff_t>((lines + BLOCK - 1) / BLOCK);
+    // The half length lines along z already give twice the values
+    const float scale = 2.0f / static_cast<float>(size * size * size);
+
+    transform_axis(spectrum, size, half_size, size * half_size, true);
+    transform_axis(spectrum, extent, size * half_size, half_size, true);
+    buffers.resize(omp_get_max_threads());
+
+    #pragma omp parallel
+    {
+        aligned_vector<float>& buffer = buffers[omp_get_thread_num()];
+        buffer.resize(2 * BLOCK * size);
+        float* packed_real = buffer.data();
+        float* packed_imaginary = buffer.data() + BLOCK * size;
+
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t block = 0; block < blocks; ++block) {
+            const size_t width = std::min(BLOCK, lines - static_cast<size_t>(block) * BLOCK);
+
+            for (size_t b = 0; b < BLOCK; ++b) {
+                const size_t line = static_cast<size_t>(block) * BLOCK + std::min(b, width - 1);
+                const Complex* coefficients = spectrum + ((line / extent) * size + line % extent) * half_size;
+                for (size_t k = 0; k < middle; ++k) {
+                    const Complex value = coefficients[k];
+                    const Complex mirrored = coefficients[middle - k];
+                    const float even_real = 0.5f * (value.real() + mirrored.real());
+                    const float even_imaginary = 0.5f * (value.imag() - mirrored.imag());
+                    const float difference_real = 0.5f * (value.real() - mirrored.real());
+                    const float difference_imaginary = 0.5f * (value.imag() + mirrored.imag());
+                    // odd = difference * conj(twiddle), packed = even + i odd
+                    const float odd_real = difference_real * twiddles_real[k] + difference_imaginary * twiddles_imaginary[k];
+                    const float odd_imaginary = difference_imaginary * twiddles_real[k] - difference_real * twiddles_imaginary[k];
+                    packed_real[k * BLOCK + b] = even_real - odd_imaginary;
+                    packed_imaginary[k * BLOCK + b] = even_imaginary + odd_real;
+                }
+            }
+            transform(packed_real, packed_imaginary, true, true);
+
+            for (size_t b = 0; b < width; ++b) {
+                const size_t line = static_cast<size_t>(block) * BLOCK + b;
+                float* values = real + ((line / extent) * size + line % extent) * size;
+                for (size_t m = 0; m < middle; ++m) {
+                    values[2 * m] = scale * packed_real[m * BLOCK + b];
+                    values[2 * m + 1] = scale * packed_imaginary[m * BLOCK + b];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,514 @@
+/*
+ * @path src/simulation/fmm.cpp
+ * @file fmm.cpp
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <omp.h>
+#include "simulation/fmm.hpp"
+
+namespace {
+    constexpr int count_terms(int degree) {
+        return (degree + 1) * (degree + 2) * (degree + 3) / 6;
+    }
+
+    constexpr int MAX_EXPANSION_TERMS = count_terms(FMM::MAX_ORDER);
+}
+
+FMM::FMM(int bodies_count) {
+    // Resize the body store
+    set_body_count(bodies_count);
+}
+
+void FMM::Terms::prepare(int order) {
+    this->order = order;
+    const int degree = order;
+    const int side = degree + 1;
+
+    exponents.clear();
+    std::vector<int> lookup(side * side * side, -1);
+    for (int d = 0; d <= degree; ++d) {
+        for (int a = d; a >= 0; --a) {
+            for (int b = d - a; b >= 0; --b) {
+                const int c = d - a - b;
+                lookup[(a * side + b) * side + c] = static_cast<int>(exponents.size());
+                exponents.push_back({a, b, c});
+            }
+        }
+    }
+    const auto index = [&](int a, int b, int c) {
+        return lookup[(a * side + b) * side + c];
+    };
+
+    inverse_factorials.resize(exponents.size());
+    steps.resize(exponents.size());
+    for (size_t i = 0; i < exponents.size(); ++i) {
+        const auto [a, b, c] = exponents[i];
+        inverse_factorials[i] = 1.0 / (std::tgamma(a + 1) * std::tgamma(b + 1) * std::tgamma(c + 1));
+
+        // R(j)[n + e] = n_axis * R(j + 1)[n - e] + r_axis * R(j + 1)[n], recursing on the first
+        // axis with a non-zero exponent
+        if (i == 0) {
+            continue;
+        }
+        Step& step = steps[i];
+        std::array<int, 3> lower = exponents[i];
+        step.axis = a > 0 ? 0 : (b > 0 ? 1 : 2);
+        lower[step.axis] -= 1;
+        step.lower = index(lower[0], lower[1], lower[2]);
+        step.coefficient = lower[step.axis];
+        if (lower[step.axis] > 0) {
+            lower[step.axis] -= 1;
+            step.lower_twice = index(lower[0], lower[1], lower[2]);
+        }
+    }
+
+    const int expansion_size = size();
+    shifts.clear();
+    transfers.clear();
+    transfer_counts.resize(expansion_size);
+    for (int n = 0; n < expansion_size; ++n) {
+        const auto [a, b, c] = exponents[n];
+        for (int k = 0; k < expansion_size; ++k) {
+            const auto [ka, kb, kc] = exponents[k];
+            if (ka <= a && kb <= b && kc <= c) {
+                shifts.push_back({n, k, index(a - ka, b - kb, c - kc)});
+            }
+        }
+
+        // The sources of a local term are a prefix, the multipoles up to the remaining degree
+        transfer_counts[n] = count(order - (a + b + c));
+        for (int k = 0; k < transfer_counts[n]; ++k) {
+            const auto [ka, kb, kc] = exponents[k];
+            transfers.push_back(index(a + ka, b + kb, c + kc));
+        }
+    }
+
+    gradients.resize(count(order - 1));
+    for (size_t m = 0; m < gradients.size(); ++m) {
+        const auto [a, b, c] = exponents[m];
+        gradients[m] = {index(a + 1, b, c), index(a, b + 1, c), index(a, b, c + 1)};
+    }
+}
+
+int FMM::Terms::count(int degree) {
+    return count_terms(degree);
+}
+
+int FMM::Terms::size() const {
+    return count(order);
+}
+
+void FMM::calculate_forces() {
+    const size_t count = bodies.size();
+    if (count == 0) {
+        return;
+    }
+
+    const int order = std::clamp(expansion_order, 1, MAX_ORDER);
+    if (terms.order != order) {
+        terms.prepare(order);
+    }
+
+    // Tracers and the bodies past the interaction percentage are left out of the tree, like in
+    // the tree walk
+    const size_t sources = get_source_count();
+    if (sources == 0) {
+        for (auto& component : bodies.acceleration) {
+            std::fill(component.begin(), component.end(), 0.0f);
+        }
+        return;
+    }
+
+    // Between rebuilds only the node bounds are refitted to the moved bodies.
+    const bool refitted = ++steps_since_build < refit_interval && octree.get_body_count() == sources && octree.get_dimension() == dimension && octree.refit(bodies);
+
+    if (!refitted) {
+        bound = bound.follow(Bound::enclosing(bodies, sources), bound_hysteresis);
+        octree.build(bodies, sources, bound, static_cast<u_int>(fmm_leaf_capacity), dimension);
+        steps_since_build = 0;
+    }
+
+    octree.calculate_center_of_mass();
+    locate_outside(sources, count);
+
+    // Any opening angle above one would let a cell accept its own ancestors
+    upward();
+    downward(std::min(theta, 1.0f), softening_factor * softening_factor);
+}
+
+void FMM::locate_outside(size_t first, size_t last) {
+    const Arena<Node>& nodes = octree.get_nodes();
+    const auto count = static_cast<std::ptrdiff_t>(last - first);
+    outside_leaves.resize(last - first);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t t = 0; t < count; ++t) {
+        const glm::vec3 position = bodies.get_position(first + t);
+        u_int index = 0;
+        while (!nodes[index].is_leaf()) {
+            const Node& node = nodes[index];
+            u_int nearest = node.first_child;
+            float nearest_squared = std::numeric_limits<float>::max();
+            for (u_int c = node.first_child; c < node.first_child + node.child_count; ++c) {
+                const glm::vec3 gap = glm::max(glm::abs(position - nodes[c].bound.center) - nodes[c].bound.half_width, glm::vec3(0.0f));
+                const float gap_squared = glm::dot(gap, gap);
+                if (gap_squared < nearest_squared) {
+                    nearest = c;
+                    nearest_squared = gap_squared;
+                }
+            }
+            index = nearest;
+        }
+        outside_leaves[t] = index;
+    }
+
+    // Counting sort by leaf, the offsets end up one node ahead and are shifted back
+    outside_offsets.assign(nodes.size() + 1, 0);
+    for (const u_int leaf : outside_leaves) {
+        ++outside_offsets[leaf + 1];
+    }
+    for (size_t i = 1; i < outside_offsets.size(); ++i) {
+        outside_offsets[i] += outside_offsets[i - 1];
+    }
+    outside_bodies.resize(last - first);
+    for (std::ptrdiff_t t = 0; t < count; ++t) {
+        outside_bodies[outside_offsets[outside_leaves[t]]++] = static_cast<u_int>(first + t);
+    }
+    for (size_t i = outside_offsets.size() - 1; i > 0; --i) {
+        outside_offsets[i] = outside_offsets[i - 1];
+    }
+    outside_offsets[0] = 0;
+}
+
+void FMM::upward() {
+    const Arena<Node>& nodes = octree.get_nodes();
+    const std::vector<u_int>& levels = octree.get_levels();
+    const auto& positions = octree.get_positions();
+    const auto& masses = octree.get_masses();
+    const int size = terms.size();
+
+    multipoles.resize(nodes.size() * size);
+    radii.resize(nodes.size());
+    parents.resize(nodes.size());
+    parents[0] = 0;
+
+    // P2M at the leaves and M2M into the parents, deepest level first like the center of mass.
+    // The moments are taken about the body as seen from the center, which folds the (-1)^|n|
+    // of expanding the kernel about the source into the multipoles.
+    for (size_t level = levels.size() - 1; level-- > 0;) {
+        const auto level_begin = static_cast<std::ptrdiff_t>(levels[level]);
+        const auto level_end = static_cast<std::ptrdiff_t>(levels[level + 1]);
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (std::ptrdiff_t i = level_begin; i < level_end; ++i) {
+            const Node& node = nodes[i];
+            const glm::dvec3 center(node.center_of_mass);
+            double* multipole = multipoles.data() + i * size;
+            std::array<double, MAX_EXPANSION_TERMS> power {};
+            double radius = 0.0;
+
+            std::fill(multipole, multipole + size, 0.0);
+
+            if (node.is_leaf()) {
+                for (u_int j = node.first_body; j < node.first_body + node.body_count; ++j) {
+                    const glm::dvec3 offset = center - glm::dvec3(positions[0][j], positions[1][j], positions[2][j]);
+                    powers(offset, terms.order, power.data());
+                    for (int t = 0; t < size; ++t) {
+                        multipole[t] += masses[j] * power[t] * terms.inverse_factorials[t];
+                    }
+                    radius = std::max(radius, glm::length(offset));
+                }
+
+                // The local expansion of the leaf also has to hold at the bodies handed to it
+                for (u_int t = outside_offsets[i]; t < outside_offsets[i + 1]; ++t) {
+                    radius = std::max(radius, glm::length(center - glm::dvec3(bodies.get_position(outside_bodies[t]))));
+                }
+            } else {
+                for (u_int c = node.first_child; c < node.first_child + node.child_count; ++c) {
+                    const glm::dvec3 offset = center - glm::dvec3(nodes[c].center_of_mass);
+                    const double* child = multipoles.data() + c * size;
+                    powers(offset, terms.order, power.data());
+                    for (const Terms::Shift& shift : terms.shifts) {
+                        multipole[shift.target] += child[shift.source] * power[shift.offset] * terms.inverse_factorials[shift.offset];
+                    }
+                    radius = std::max(radius, glm::length(offset) + radii[c]);
+                    parents[c] = static_cast<u_int>(i);
+                }
+            }
+
+            radii[i] = static_cast<float>(radius);
+        }
+    }
+}
+
+void FMM::downward(float theta, float softening_squared) {
+    const Arena<Node>& nodes = octree.get_nodes();
+    const std::vector<u_int>& levels = octree.get_levels();
+    const int size = terms.size();
+    const auto thread_count = static_cast<size_t>(omp_get_max_threads());
+
+    locals.resize(nodes.size() * size);
+    deferred.resize(nodes.size());
+    neighbours.resize(thread_count);
+    scratches.resize(thread_count);
+    for (auto& buffers : deferred_buffers) {
+        buffers.resize(thread_count);
+    }
+
+    // Dual tree traversal one target level at a time: a node handles the source cells its
+    // parent deferred and defers the ones it is too large for to its own children. A level
+    // only needs the local expansions of its parents, so the nodes of one level are independent.
+    const u_int root = 0;
+    for (size_t level = 0; level + 1 < levels.size(); ++level) {
+        const auto level_begin = static_cast<std::ptrdiff_t>(levels[level]);
+        const auto level_end = static_cast<std::ptrdiff_t>(levels[level + 1]);
+        const auto& reading = deferred_buffers[(level + 1) % 2];
+        auto& writing = deferred_buffers[level % 2];
+
+        #pragma omp parallel
+        {
+            const auto thread = static_cast<u_int>(omp_get_thread_num());
+            std::vector<u_int>& children = writing[thread];
+            InteractionList& near = neighbours[thread];
+            aligned_vector<double>& scratch = scratches[thread];
+            scratch.resize(3 * size * BATCH);
+            children.clear();
+
+            #pragma omp for schedule(dynamic, 16)
+            for (std::ptrdiff_t i = level_begin; i < level_end; ++i) {
+                const Node& node = nodes[i];
+                double* local = locals.data() + i * size;
+                std::fill(local, local + size, 0.0);
+
+                const u_int* candidates = &root;
+                size_t candidate_count = 1;
+
+                // L2L from the parent
+                if (i != 0) {
+                    const u_int parent = parents[i];
+                    const double* parent_local = locals.data() + parent * size;
+                    std::array<double, MAX_EXPANSION_TERMS> power {};
+                    powers(glm::dvec3(node.center_of_mass) - glm::dvec3(nodes[parent].center_of_mass), terms.order, power.data());
+                    for (const Terms::Shift& shift : terms.shifts) {
+                        local[shift.source] += parent_local[shift.target] * power[shift.offset] * terms.inverse_factorials[shift.offset];
+                    }
+
+                    const Deferred& inherited = deferred[parent];
+                    candidates = reading[inherited.thread].data() + inherited.begin;
+                    candidate_count = inherited.end - inherited.begin;
+                }
+
+                Deferred& own = deferred[i];
+                own.thread = thread;
+                own.begin = static_cast<u_int>(children.size());
+                near.clear();
+                interact(static_cast<u_int>(i), candidates, candidate_count, theta, softening_squared, children, near.ranges, scratch.data());
+                own.end = static_cast<u_int>(children.size());
+
+                if (node.is_leaf()) {
+                    evaluate(static_cast<u_int>(i), near, softening_squared);
+                }
+            }
+        }
+    }
+}
+
+void FMM::interact(u_int target, const u_int* candidates, size_t candidate_count, float theta, double softening_squared, std::vector<u_int>& children, std::vector<std::pair<u_int, u_int>>& ranges, double* scratch) {
+    const Arena<Node>& nodes = octree.get_nodes();
+    const Node& node = nodes[target];
+    std::array<u_int, BATCH> batch {};
+    int batched = 0;
+
+    // Below this many body pairs the direct sum is cheaper than a transfer
+    const auto direct_pairs = static_cast<u_int>(DIRECT_PAIRS_PER_TERM * static_cast<float>(terms.transfers.size()));
+
+    // Every pop pushes at most eight children, so the stack never holds more than this
+    std::array<u_int, 8 * (Morton::LEVELS + 1)> stack {};
+
+    for (size_t candidate = 0; candidate < candidate_count; ++candidate) {
+        size_t top = 0;
+        stack[top++] = candidates[candidate];
+
+        while (top > 0) {
+            const u_int index = stack[--top];
+            const Node& source = nodes[index];
+
+            if (node.is_leaf() && node.body_count * source.body_count < direct_pairs) {
+                // Summing the pairs is cheaper than expanding them, the bodies of any subtree
+                // are contiguous
+                ranges.emplace_back(source.first_body, source.body_count);
+            } else if (separated(target, index, theta)) {
+                // M2L, the accepted sources are transferred in batches
+                batch[batched++] = index;
+                if (batched == BATCH) {
+                    transfer(target, batch.data(), batched, softening_squared, scratch);
+                    batched = 0;
+                }
+            } else if (node.is_leaf() && source.is_leaf()) {
+                // P2P once both sides are leaves
+                ranges.emplace_back(source.first_body, source.body_count);
+            } else if (node.is_leaf() || (!source.is_leaf() && radii[index] > radii[target])) {
+                // The larger cell of the pair is split
+                for (u_int c = source.first_child; c < source.first_child + source.child_count; ++c) {
+                    stack[top++] = c;
+                }
+            } else {
+                children.push_back(index);
+            }
+        }
+    }
+
+    if (batched > 0) {
+        transfer(target, batch.data(), batched, softening_squared, scratch);
+    }
+}
+
+void FMM::evaluate(u_int leaf, InteractionList& near, float softening_squared) {
+    const Node& node = octree.get_nodes()[leaf];
+    const auto& positions = octree.get_positions();
+    const auto& masses = octree.get_masses();
+    const std::vector<u_int>& indices = octree.get_indices();
+    const glm::dvec3 center(node.center_of_mass);
+    const double* local = locals.data() + leaf * terms.size();
+    const auto gradient_size = static_cast<int>(terms.gradients.size());
+
+    std::array<double, MAX_EXPANSION_TERMS> power {};
+
+    // The near field is packed once per leaf so that every body is one kernel call
+    for (const auto& [first, count] : near.ranges) {
+        for (u_int j = first; j < first + count; ++j) {
+            near.push(glm::vec3(positions[0][j], positions[1][j], positions[2][j]), masses[j]);
+        }
+    }
+
+    // The bodies of the leaf, then the ones outside the tree handed to it
+    const u_int outside_first = outside_offsets[leaf];
+    const u_int outside_count = outside_offsets[leaf + 1] - outside_first;
+    for (u_int n = 0; n < node.body_count + outside_count; ++n) {
+        const bool inside = n < node.body_count;
+        const u_int j = node.first_body + n;
+        const u_int body = inside ? indices[j] : outside_bodies[outside_first + n - node.body_count];
+        const glm::vec3 position = inside ? glm::vec3(positions[0][j], positions[1][j], positions[2][j]) : bodies.get_position(body);
+
+        // L2P, the gradient of the local expansion is the far field
+        powers(glm::dvec3(position) - center, terms.order - 1, power.data());
+        glm::dvec3 far(0.0);
+        for (int m = 0; m < gradient_size; ++m) {
+            const double weight = power[m] * terms.inverse_factorials[m];
+            for (int k = 0; k < 3; ++k) {
+                far[k] += local[terms.gradients[m][k]] * weight;
+            }
+        }
+
+        // P2P with the neighbouring leaves
+        const glm::vec3 acceleration = gravity * (glm::vec3(far) + Kernel::evaluate(position, near, softening_squared, dimension));
+        for (int k = 0; k < 3; ++k) {
+            bodies.acceleration[k][body] = acceleration[k];
+        }
+    }
+}
+
+void FMM::powers(const glm::dvec3& d, int degree, double* result) const {
+    std::array<std::array<double, MAX_ORDER + 1>, 3> axis_powers {};
+    for (int k = 0; k < 3; ++k) {
+        axis_powers[k][0] = 1.0;
+        for (int e = 1; e <= degree; ++e) {
+            axis_powers[k][e] = axis_powers[k][e - 1] * d[k];
+        }
+    }
+
+    const int size = Terms::count(degree);
+    for (int t = 0; t < size; ++t) {
+        const auto [a, b, c] = terms.exponents[t];
+        result[t] = axis_powers[0][a] * axis_powers[1][b] * axis_powers[2][c];
+    }
+}
+
+void FMM::transfer(u_int target, const u_int* sources, int count, double softening_squared, double* scratch) {
+    const Arena<Node>& nodes = octree.get_nodes();
+    const int size = terms.size();
+    const int degree = terms.order;
+    const glm::dvec3 center(nodes[target].center_of_mass);
+
+    double* previous = scratch;
+    double* current = scratch + size * BATCH;
+    double* multipole = scratch + 2 * size * BATCH;
+
+    // Every lane carries one source, lanes past the count get a massless source
+    alignas(64) std::array<std::array<double, BATCH>, 3> r {};
+    alignas(64) std::array<double, BATCH> inverse_squared {};
+    alignas(64) std::array<std::array<double, BATCH>, MAX_ORDER + 1> roots {};
+
+    for (int l = 0; l < BATCH; ++l) {
+        const bool used = l < count;
+        const glm::dvec3 d = used ? center - glm::dvec3(nodes[sources[l]].center_of_mass) : glm::dvec3(1.0, 0.0, 0.0);
+        const double* source = multipoles.data() + (used ? sources[l] : 0) * size;
+        for (int k = 0; k < 3; ++k) {
+            r[k][l] = d[k];
+        }
+        for (int n = 0; n < size; ++n) {
+            multipole[n * BATCH + l] = used ? source[n] : 0.0;
+        }
+        inverse_squared[l] = 1.0 / (glm::dot(d, d) + softening_squared);
+        roots[0][l] = std::sqrt(inverse_squared[l]);
+    }
+
+    // Derivatives of the softened kernel 1 / sqrt(r^2 + e^2) with the Hermite recursion, starting
+    // from R(j)[0, 0, 0] = (-1)^j (2j - 1)!! / s^(2j + 1) and lowering j one degree at a time
+    for (int j = 1; j <= degree; ++j) {
+        #pragma omp simd
+        for (int l = 0; l < BATCH; ++l) {
+            roots[j][l] = -(2 * j - 1) * roots[j - 1][l] * inverse_squared[l];
+        }
+    }
+
+    for (int j = degree; j >= 0; --j) {
+        std::copy(roots[j].begin(), roots[j].end(), current);
+        const int level_size = Terms::count(degree - j);
+        for (int i = 1; i < level_size; ++i) {
+            const Terms::Step& step = terms.steps[i];
+            const double* axis = r[step.axis].data();
+            const double* lower = previous + step.lower * BATCH;
+            const double* lower_twice = previous + step.lower_twice * BATCH;
+            double* value = current + i * BATCH;
+
+            #pragma omp simd
+            for (int l = 0; l < BATCH; ++l) {
+                value[l] = axis[l] * lower[l] + step.coefficient * lower_twice[l];
+            }
+        }
+        std::swap(previous, current);
+    }
+
+    // M2L, L[m] += sum over n of M[n] D[n + m], truncated at |n| + |m| <= order: the dropped
+    // terms are as small as the multipoles past the order that are never computed
+    double* local = locals.data() + target * size;
+    const int* transfer = terms.transfers.data();
+    for (int m = 0; m < size; ++m) {
+        const int transfer_count = terms.transfer_counts[m];
+        alignas(64) std::array<double, BATCH> sum {};
+        for (int n = 0; n < transfer_count; ++n) {
+            const double* derivative = previous + transfer[n] * BATCH;
+            const double* moment = multipole + n * BATCH;
+
+            #pragma omp simd
+            for (int l = 0; l < BATCH; ++l) {
+                sum[l] += moment[l] * derivative[l];
+            }
+        }
+        for (int l = 0; l < BATCH; ++l) {
+            local[m] += sum[l];
+        }
+        transfer += transfer_count;
+    }
+}
+
+bool FMM::separated(u_int a, u_int b, float theta) const {
+    const Arena<Node>& nodes = octree.get_nodes();
+    const glm::vec3 d = nodes[a].center_of_mass - nodes[b].center_of_mass;
+    const float extent = radii[a] + radii[b];
+    return extent * extent < theta * theta * glm::dot(d, d);
+}
@@ -0,0 +1,114 @@
+/*
+ * @path src/simulation/kepler.cpp
+ * @file kepler.cpp
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "simulation/kepler.hpp"
+
+void Kepler::stumpff(double z, double (&c)[4]) {
+    if (std::abs(z) < 0.1) {
+        // The closed forms cancel near zero, the series converges fast there
+        for (int k = 0; k < 4; ++k) {
+            double term = 1.0;
+            for (int j = 2; j <= k; ++j) {
+                term /= j;
+            }
+            double sum = term;
+            for (int n = 1; n <= 6; ++n) {
+                term *= -z / static_cast<double>((k + 2 * n - 1) * (k + 2 * n));
+                sum += term;
+            }
+            c[k] = sum;
+        }
+        return;
+    }
+
+    if (z > 0.0) {
+        const double root = std::sqrt(z);
+        c[0] = std::cos(root);
+        c[1] = std::sin(root) / root;
+    } else {
+        const double root = std::sqrt(-z);
+        c[0] = std::cosh(root);
+        c[1] = std::sinh(root) / root;
+    }
+    c[2] = (1.0 - c[0]) / z;
+    c[3] = (1.0 - c[1]) / z;
+}
+
+void Kepler::drift(double mu, double delta_time, glm::dvec3& position, glm::dvec3& velocity) {
+    const double r0 = glm::length(position);
+    const double eta = glm::dot(position, velocity);
+    const double beta = 2.0 * mu / r0 - glm::dot(velocity, velocity);
+
+    // Whole periods of a bound orbit change nothing, the anomaly stays small
+    if (beta > 0.0) {
+        const double period = 2.0 * M_PI * mu / (beta * std::sqrt(beta));
+        delta_time = std::fmod(delta_time, period);
+    }
+
+    // Time of flight r0 G1 + eta G2 + mu G3 at the universal anomaly s, its derivative is the distance
+    double c[4];
+    double g1 = 0.0, g2 = 0.0, g3 = 0.0, r = r0;
+    const auto evaluate = [&](double s) {
+        stumpff(beta * s * s, c);
+        g1 = s * c[1];
+        g2 = s * s * c[2];
+        g3 = s * s * s * c[3];
+        r = r0 * c[0] + eta * g1 + mu * g2;
+        return r0 * g1 + eta * g2 + mu * g3 - delta_time;
+    };
+
+    // The time of flight grows with s, the root is bracketed between 0 and a guess grown until
+    // it passes the step. Halley iterations fall back to bisection when they leave the bracket,
+    // which happens from poor guesses on hyperbolic orbits.
+    double s = delta_time / r0;
+    if (beta < 0.0) {
+        // Far along a hyperbola the time of flight grows as exp(b s) / 2 (r0 / b + eta / b^2 + mu / b^3),
+        // b = sqrt(-beta), the guess from the distance alone would be much too large
+        const double b = std::sqrt(-beta);
+        const double scale = r0 / b + eta / (b * b) + mu / (b * b * b);
+        const double guess = std::log(2.0 * std::abs(delta_time) / scale) / b;
+        if (guess > 0.0 && guess < std::abs(s)) {
+            s = std::copysign(guess, delta_time);
+        }
+    }
+    double far = s;
+    for (int iteration = 0; iteration < ITERATIONS && evaluate(far) * delta_time < 0.0; ++iteration) {
+        far *= 2.0;
+    }
+    double lower = std::min(0.0, far);
+    double upper = std::max(0.0, far);
+
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+        const double f = evaluate(s);
+        if (f < 0.0) {
+            lower = s;
+        } else {
+            upper = s;
+        }
+
+        const double second = eta * c[0] + (mu - beta * r0) * g1;
+        double next = s - 2.0 * f * r / (2.0 * r * r - f * second);
+        if (!(next > lower && next < upper)) {
+            next = 0.5 * (lower + upper);
+        }
+        const double step = next - s;
+        s = next;
+        if (std::abs(step) <= TOLERANCE * std::abs(s)) {
+            break;
+        }
+    }
+    evaluate(s);
+
+    const double f = 1.0 - mu * g2 / r0;
+    const double g = delta_time - mu * g3;
+    const double f_dot = -mu * g1 / (r0 * r);
+    const double g_dot = 1.0 - mu * g2 / r;
+
+    const glm::dvec3 start = position;
+    position = f * start + g * velocity;
+    velocity = f_dot * start + g_dot * velocity;
+}
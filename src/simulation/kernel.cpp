@@ -0,0 +1,995 @@
+/*
+ * @path src/simulation/kernel.cpp
+ * @file kernel.cpp
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "simulation/kernel.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL_X86
+#include <immintrin.h>
+#endif
+
+void InteractionList::push(const glm::vec3& source_position, float source_mass) {
+    position[0].push_back(source_position.x);
+    position[1].push_back(source_position.y);
+    position[2].push_back(source_position.z);
+    mass.push_back(source_mass);
+}
+
+void InteractionList::append(const float* x, const float* y, const float* z, const float* source_mass, size_t count) {
+    position[0].insert(position[0].end(), x, x + count);
+    position[1].insert(position[1].end(), y, y + count);
+    position[2].insert(position[2].end(), z, z + count);
+    mass.insert(mass.end(), source_mass, source_mass + count);
+}
+
+void InteractionList::push_moments(const float* source_quadrupole, const float* source_octupole) {
+    for (size_t k = 0; k < quadrupole.size(); ++k) {
+        quadrupole[k].push_back(source_quadrupole[k]);
+    }
+    if (source_octupole != nullptr) {
+        for (size_t k = 0; k < octupole.size(); ++k) {
+            octupole[k].push_back(source_octupole[k]);
+        }
+    }
+}
+
+void InteractionList::push_velocity(const glm::vec3& source_velocity) {
+    for (int k = 0; k < 3; ++k) {
+        velocity[k].push_back(source_velocity[k]);
+    }
+}
+
+void InteractionList::clear() {
+    for (auto& component : position) {
+        component.clear();
+    }
+    mass.clear();
+    for (auto& component : quadrupole) {
+        component.clear();
+    }
+    for (auto& component : octupole) {
+        component.clear();
+    }
+    for (auto& component : velocity) {
+        component.clear();
+    }
+    ranges.clear();
+}
+
+size_t InteractionList::size() const {
+    return mass.size();
+}
+
+glm::vec3 Kernel::evaluate(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, u_int dimension) {
+    static const Function planar = select<2>(get_isa());
+    static const Function function = select<3>(get_isa());
+    return (dimension == 2 ? planar : function)(target, x, y, z, mass, count, softening_squared);
+}
+
+glm::vec3 Kernel::evaluate(const glm::vec3& target, const InteractionList& sources, float softening_squared, u_int dimension) {
+    return evaluate(target, sources.position[0].data(), sources.position[1].data(), sources.position[2].data(), sources.mass.data(), sources.size(), softening_squared, dimension);
+}
+
+glm::vec3 Kernel::evaluate_pairs(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared, u_int dimension) {
+    static const PairFunction planar = select_pairs<2>(get_isa());
+    static const PairFunction function = select_pairs<3>(get_isa());
+    return (dimension == 2 ? planar : function)(target, target_mass, x, y, z, mass, ax, ay, az, count, softening_squared);
+}
+
+glm::vec3 Kernel::evaluate_short_range(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split, u_int dimension) {
+    static const ShortRangeFunction planar = select_short_range<2>(get_isa());
+    static const ShortRangeFunction function = select_short_range<3>(get_isa());
+    return (dimension == 2 ? planar : function)(target, x, y, z, mass, count, softening_squared, split);
+}
+
+glm::vec3 Kernel::evaluate_short_range(const glm::vec3& target, const InteractionList& sources, float softening_squared, float split, u_int dimension) {
+    return evaluate_short_range(target, sources.position[0].data(), sources.position[1].data(), sources.position[2].data(), sources.mass.data(), sources.size(), softening_squared, split, dimension);
+}
+
+float Kernel::short_range_reach(float split, float softening_squared) {
+    const float cutoff = SHORT_RANGE_CUTOFF * split;
+    return std::sqrt(std::max(cutoff * cutoff - softening_squared, 0.0f));
+}
+
+glm::vec3 Kernel::evaluate_multipoles(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree, u_int dimension) {
+    static const MultipoleFunction planar = select_multipoles<2>(get_isa());
+    static const MultipoleFunction function = select_multipoles<3>(get_isa());
+    return (dimension == 2 ? planar : function)(target, sources, softening_squared, degree);
+}
+
+Kernel::Derivatives Kernel::evaluate_jerk(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared) {
+    static const JerkFunction function = select_jerk(get_isa());
+    return function(target, target_velocity, x, y, z, vx, vy, vz, mass, count, softening_squared);
+}
+
+Kernel::Derivatives Kernel::evaluate_jerk(const glm::vec3& target, const glm::vec3& target_velocity, const InteractionList& sources, float softening_squared) {
+    return evaluate_jerk(target, target_velocity, sources.position[0].data(), sources.position[1].data(), sources.position[2].data(),
+                         sources.velocity[0].data(), sources.velocity[1].data(), sources.velocity[2].data(), sources.mass.data(), sources.size(), softening_squared);
+}
+
+Kernel::Derivatives& Kernel::Derivatives::operator+=(const Derivatives& other) {
+    acceleration += other.acceleration;
+    jerk += other.jerk;
+    return *this;
+}
+
+Kernel::Isa Kernel::get_isa() {
+    #ifdef KERNEL_X86
+        static const Isa isa = [] {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return Isa::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return Isa::AVX2;
+            }
+            if (__builtin_cpu_supports("sse4.1")) {
+                return Isa::SSE4;
+            }
+            return Isa::SCALAR;
+        }();
+        return isa;
+    #else
+        return Isa::SCALAR;
+    #endif
+}
+
+std::string_view Kernel::get_isa_name() {
+    switch (get_isa()) {
+        case Isa::AVX512:
+            return "AVX-512";
+        case Isa::AVX2:
+            return "AVX2";
+        case Isa::SSE4:
+            return "SSE4.1";
+        default:
+            return "Scalar";
+    }
+}
+
+template <u_int DIMENSION>
+Kernel::Function Kernel::select(Isa isa) {
+    switch (isa) {
+        case Isa::AVX512:
+            return evaluate_avx512<DIMENSION>;
+        case Isa::AVX2:
+            return evaluate_avx2<DIMENSION>;
+        case Isa::SSE4:
+            return evaluate_sse4<DIMENSION>;
+        default:
+            return evaluate_scalar<DIMENSION>;
+    }
+}
+
+template <u_int DIMENSION>
+Kernel::PairFunction Kernel::select_pairs(Isa isa) {
+    // The scatter to the sources gains little from 4 lanes, SSE4 keeps the scalar loop
+    switch (isa) {
+        case Isa::AVX512:
+            return evaluate_pairs_avx512<DIMENSION>;
+        case Isa::AVX2:
+            return evaluate_pairs_avx2<DIMENSION>;
+        default:
+            return evaluate_pairs_scalar<DIMENSION>;
+    }
+}
+
+template <u_int DIMENSION>
+Kernel::MultipoleFunction Kernel::select_multipoles(Isa isa) {
+    switch (isa) {
+        case Isa::AVX512:
+            return evaluate_multipoles_avx512<DIMENSION>;
+        case Isa::AVX2:
+            return evaluate_multipoles_avx2<DIMENSION>;
+        default:
+            return evaluate_multipoles_scalar<DIMENSION>;
+    }
+}
+
+Kernel::JerkFunction Kernel::select_jerk(Isa isa) {
+    switch (isa) {
+        case Isa::AVX512:
+            return evaluate_jerk_avx512;
+        case Isa::AVX2:
+            return evaluate_jerk_avx2;
+        default:
+            return evaluate_jerk_scalar;
+    }
+}
+
+template <u_int DIMENSION>
+Kernel::ShortRangeFunction Kernel::select_short_range(Isa isa) {
+    switch (isa) {
+        case Isa::AVX512:
+            return evaluate_short_range_avx512<DIMENSION>;
+        case Isa::AVX2:
+            return evaluate_short_range_avx2<DIMENSION>;
+        default:
+            return evaluate_short_range_scalar<DIMENSION>;
+    }
+}
+
+// Planar kernels (DIMENSION 2) neither read z nor sum the z component
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_scalar(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    float ax = 0.0f, ay = 0.0f, az = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const float dx = x[i] - target.x;
+        const float dy = y[i] - target.y;
+        const float dz = DIMENSION == 3 ? z[i] - target.z : 0.0f;
+        const float distance_squared = (DIMENSION == 3 ? dx * dx + dy * dy + dz * dz : dx * dx + dy * dy) + softening_squared;
+        // A body never attracts itself, r = 0 must not turn into 0 * inf
+        const float inv_distance = distance_squared > 0.0f ? 1.0f / std::sqrt(distance_squared) : 0.0f;
+        const float strength = mass[i] * inv_distance * inv_distance * inv_distance;
+        ax += dx * strength;
+        ay += dy * strength;
+        az += dz * strength;
+    }
+    return {ax, ay, az};
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_pairs_scalar(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared) {
+    float sum_x = 0.0f, sum_y = 0.0f, sum_z = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const float dx = x[i] - target.x;
+        const float dy = y[i] - target.y;
+        const float dz = DIMENSION == 3 ? z[i] - target.z : 0.0f;
+        const float distance_squared = (DIMENSION == 3 ? dx * dx + dy * dy + dz * dz : dx * dx + dy * dy) + softening_squared;
+        const float inv_distance = distance_squared > 0.0f ? 1.0f / std::sqrt(distance_squared) : 0.0f;
+        const float inv_cube = inv_distance * inv_distance * inv_distance;
+        const float strength = mass[i] * inv_cube;
+        const float reaction = target_mass * inv_cube;
+        sum_x += dx * strength;
+        sum_y += dy * strength;
+        sum_z += dz * strength;
+        ax[i] -= dx * reaction;
+        ay[i] -= dy * reaction;
+        if constexpr (DIMENSION == 3) {
+            az[i] -= dz * reaction;
+        }
+    }
+    return {sum_x, sum_y, sum_z};
+}
+
+// The short range factor erfc(u) + 2 u / sqrt(pi) exp(-u^2) is 1 - u^3 Q(u^2), Q fitted by a
+// polynomial up to the cutoff with an absolute error of the factor below 2e-5. Past the cutoff
+// the factor is zero, the walk leaves those sources to the long range solver as well.
+static constexpr float SHORT_RANGE_Q[8] = {7.520226240e-01f, -4.501131177e-01f, 1.587177068e-01f, -3.924325481e-02f, 7.012951653e-03f, -8.664087509e-04f, 6.563212810e-05f, -2.269182460e-06f};
+static constexpr float SHORT_RANGE_MAX_SQUARED = 0.25f * Kernel::SHORT_RANGE_CUTOFF * Kernel::SHORT_RANGE_CUTOFF;
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_short_range_scalar(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split) {
+    const float scale = 0.5f / split;
+    float ax = 0.0f, ay = 0.0f, az = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const float dx = x[i] - target.x;
+        const float dy = y[i] - target.y;
+        const float dz = DIMENSION == 3 ? z[i] - target.z : 0.0f;
+        const float distance_squared = (DIMENSION == 3 ? dx * dx + dy * dy + dz * dz : dx * dx + dy * dy) + softening_squared;
+        const float inv_distance = distance_squared > 0.0f ? 1.0f / std::sqrt(distance_squared) : 0.0f;
+        const float u = distance_squared * inv_distance * scale;
+        const float u_squared = u * u;
+        float series = SHORT_RANGE_Q[7];
+        for (int k = 6; k >= 0; --k) {
+            series = series * u_squared + SHORT_RANGE_Q[k];
+        }
+        const float factor = u_squared < SHORT_RANGE_MAX_SQUARED ? 1.0f - u * u_squared * series : 0.0f;
+        const float strength = mass[i] * inv_distance * inv_distance * inv_distance * factor;
+        ax += dx * strength;
+        ay += dy * strength;
+        az += dz * strength;
+    }
+    return {ax, ay, az};
+}
+
+// Cells from first on, r is the target relative to the center of mass of a cell and D(n) the
+// n-th radial derivative of the softened 1 / s, D(n + 1) = -(2n + 1) D(n) / s^2. Then
+//     monopole    m D1 r
+//     quadrupole  1/2 (tr(Q) r + 2 Q r) D2 + 1/2 (r Q r) r D3
+//     octupole    -1/2 t D2 - 1/2 (O r r + (t . r) r) D3 - 1/6 (O r r r) r D4, t_i = O_ijj
+// Planar cells have no moments along z, DIMENSION 2 leaves them out.
+template <u_int DIMENSION>
+static glm::vec3 multipoles_scalar(const glm::vec3& target, const InteractionList& sources, size_t first, float softening_squared, int degree) {
+    const float* x = sources.position[0].data();
+    const float* y = sources.position[1].data();
+    const float* z = sources.position[2].data();
+    const float* mass = sources.mass.data();
+    const auto& q = sources.quadrupole;
+    const auto& o = sources.octupole;
+
+    glm::vec3 result(0.0f);
+    for (size_t i = first; i < sources.size(); ++i) {
+        const float rx = target.x - x[i];
+        const float ry = target.y - y[i];
+        const float rz = DIMENSION == 3 ? target.z - z[i] : 0.0f;
+        const float distance_squared = (DIMENSION == 3 ? rx * rx + ry * ry + rz * rz : rx * rx + ry * ry) + softening_squared;
+        // Accepted cells are never at the target, so the distance is not zero
+        const float inv_distance = 1.0f / std::sqrt(distance_squared);
+        const float inv_squared = inv_distance * inv_distance;
+        const float d1 = -inv_distance * inv_squared;
+        const float d2 = -3.0f * d1 * inv_squared;
+        const float d3 = -5.0f * d2 * inv_squared;
+
+        const float qx = DIMENSION == 3 ? q[0][i] * rx + q[1][i] * ry + q[2][i] * rz : q[0][i] * rx + q[1][i] * ry;
+        const float qy = DIMENSION == 3 ? q[1][i] * rx + q[3][i] * ry + q[4][i] * rz : q[1][i] * rx + q[3][i] * ry;
+        const float qz = DIMENSION == 3 ? q[2][i] * rx + q[4][i] * ry + q[5][i] * rz : 0.0f;
+        const float trace = DIMENSION == 3 ? q[0][i] + q[3][i] + q[5][i] : q[0][i] + q[3][i];
+        const float rqr = DIMENSION == 3 ? rx * qx + ry * qy + rz * qz : rx * qx + ry * qy;
+
+        float radial = mass[i] * d1 + 0.5f * (d2 * trace + d3 * rqr);
+        glm::vec3 acceleration = d2 * glm::vec3(qx, qy, qz);
+
+        if (degree >= 3) {
+            const float d4 = -7.0f * d3 * inv_squared;
+            float orr_x = 0.0f, orr_y = 0.0f, orr_z = 0.0f;
+            float tx = 0.0f, ty = 0.0f, tz = 0.0f;
+            if constexpr (DIMENSION == 3) {
+                const float xx = rx * rx, yy = ry * ry, zz = rz * rz;
+                const float xy = 2.0f * rx * ry, xz = 2.0f * rx * rz, yz = 2.0f * ry * rz;
+                orr_x = o[0][i] * xx + o[3][i] * yy + o[5][i] * zz + o[1][i] * xy + o[2][i] * xz + o[4][i] * yz;
+                orr_y = o[1][i] * xx + o[6][i] * yy + o[8][i] * zz + o[3][i] * xy + o[4][i] * xz + o[7][i] * yz;
+                orr_z = o[2][i] * xx + o[7][i] * yy + o[9][i] * zz + o[4][i] * xy + o[5][i] * xz + o[8][i] * yz;
+                tx = o[0][i] + o[3][i] + o[5][i];
+                ty = o[1][i] + o[6][i] + o[8][i];
+                tz = o[2][i] + o[7][i] + o[9][i];
+            } else {
+                const float xx = rx * rx, yy = ry * ry, xy = 2.0f * rx * ry;
+                orr_x = o[0][i] * xx + o[3][i] * yy + o[1][i] * xy;
+                orr_y = o[1][i] * xx + o[6][i] * yy + o[3][i] * xy;
+                tx = o[0][i] + o[3][i];
+                ty = o[1][i] + o[6][i];
+            }
+            const float orrr = rx * orr_x + ry * orr_y + rz * orr_z;
+            const float tr = rx * tx + ry * ty + rz * tz;
+
+            radial -= 0.5f * d3 * tr + d4 * orrr / 6.0f;
+            acceleration -= 0.5f * d2 * glm::vec3(tx, ty, tz) + 0.5f * d3 * glm::vec3(orr_x, orr_y, orr_z);
+        }
+
+        result += acceleration + radial * glm::vec3(rx, ry, rz);
+    }
+    return result;
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_multipoles_scalar(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree) {
+    return multipoles_scalar<DIMENSION>(target, sources, 0, softening_squared, degree);
+}
+
+Kernel::Derivatives Kernel::evaluate_jerk_scalar(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared) {
+    Derivatives result;
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3 r(x[i] - target.x, y[i] - target.y, z[i] - target.z);
+        const glm::vec3 v(vx[i] - target_velocity.x, vy[i] - target_velocity.y, vz[i] - target_velocity.z);
+        const float distance_squared = glm::dot(r, r) + softening_squared;
+        if (distance_squared <= 0.0f) {
+            continue;
+        }
+
+        const float inv_distance = 1.0f / std::sqrt(distance_squared);
+        const float inv_squared = inv_distance * inv_distance;
+        const float strength = mass[i] * inv_distance * inv_squared;
+        result.acceleration += strength * r;
+        result.jerk += strength * (v - 3.0f * glm::dot(r, v) * inv_squared * r);
+    }
+    return result;
+}
+
+#ifdef KERNEL_X86
+
+__attribute__((target("sse4.1")))
+static float horizontal_sum(__m128 value) {
+    const __m128 shuffled = _mm_movehdup_ps(value);
+    const __m128 sums = _mm_add_ps(value, shuffled);
+    return _mm_cvtss_f32(_mm_add_ss(sums, _mm_movehl_ps(shuffled, sums)));
+}
+
+template <u_int DIMENSION>
+__attribute__((target("sse4.1")))
+glm::vec3 Kernel::evaluate_sse4(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    const __m128 tx = _mm_set1_ps(target.x);
+    const __m128 ty = _mm_set1_ps(target.y);
+    const __m128 tz = _mm_set1_ps(target.z);
+    const __m128 eps2 = _mm_set1_ps(softening_squared);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 three_halves = _mm_set1_ps(1.5f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 ax = zero, ay = zero, az = zero;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), tx);
+        const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), ty);
+        const __m128 dz = DIMENSION == 3 ? _mm_sub_ps(_mm_loadu_ps(z + i), tz) : zero;
+        const __m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), DIMENSION == 3 ? _mm_add_ps(_mm_mul_ps(dz, dz), eps2) : eps2);
+
+        // 12 bit estimate refined with one Newton-Raphson step
+        __m128 inv = _mm_rsqrt_ps(r2);
+        inv = _mm_mul_ps(inv, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, r2), _mm_mul_ps(inv, inv))));
+        inv = _mm_and_ps(inv, _mm_cmpgt_ps(r2, zero));
+
+        const __m128 strength = _mm_mul_ps(_mm_loadu_ps(mass + i), _mm_mul_ps(inv, _mm_mul_ps(inv, inv)));
+        ax = _mm_add_ps(ax, _mm_mul_ps(dx, strength));
+        ay = _mm_add_ps(ay, _mm_mul_ps(dy, strength));
+        az = DIMENSION == 3 ? _mm_add_ps(az, _mm_mul_ps(dz, strength)) : az;
+    }
+
+    const glm::vec3 tail = evaluate_scalar<DIMENSION>(target, x + i, y + i, z + i, mass + i, count - i, softening_squared);
+    return glm::vec3(horizontal_sum(ax), horizontal_sum(ay), horizontal_sum(az)) + tail;
+}
+
+__attribute__((target("avx2,fma")))
+static float horizontal_sum(__m256 value) {
+    return horizontal_sum(_mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1)));
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx2,fma")))
+glm::vec3 Kernel::evaluate_avx2(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    const __m256 tx = _mm256_set1_ps(target.x);
+    const __m256 ty = _mm256_set1_ps(target.y);
+    const __m256 tz = _mm256_set1_ps(target.z);
+    const __m256 eps2 = _mm256_set1_ps(softening_squared);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 ax = zero, ay = zero, az = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), tx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), ty);
+        const __m256 dz = DIMENSION == 3 ? _mm256_sub_ps(_mm256_loadu_ps(z + i), tz) : zero;
+        const __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, DIMENSION == 3 ? _mm256_fmadd_ps(dz, dz, eps2) : eps2));
+
+        __m256 inv = _mm256_rsqrt_ps(r2);
+        inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(inv, inv), three_halves));
+        inv = _mm256_and_ps(inv, _mm256_cmp_ps(r2, zero, _CMP_GT_OQ));
+
+        const __m256 strength = _mm256_mul_ps(_mm256_loadu_ps(mass + i), _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv)));
+        ax = _mm256_fmadd_ps(dx, strength, ax);
+        ay = _mm256_fmadd_ps(dy, strength, ay);
+        az = DIMENSION == 3 ? _mm256_fmadd_ps(dz, strength, az) : az;
+    }
+
+    const glm::vec3 tail = evaluate_sse4<DIMENSION>(target, x + i, y + i, z + i, mass + i, count - i, softening_squared);
+    return glm::vec3(horizontal_sum(ax), horizontal_sum(ay), horizontal_sum(az)) + tail;
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx512f")))
+glm::vec3 Kernel::evaluate_avx512(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    const __m512 tx = _mm512_set1_ps(target.x);
+    const __m512 ty = _mm512_set1_ps(target.y);
+    const __m512 tz = _mm512_set1_ps(target.z);
+    const __m512 eps2 = _mm512_set1_ps(softening_squared);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 zero = _mm512_setzero_ps();
+
+    __m512 ax = zero, ay = zero, az = zero;
+    for (size_t i = 0; i < count; i += 16) {
+        // The tail is handled with masked loads, masked out lanes have zero mass
+        const __mmask16 lanes = count - i >= 16 ? __mmask16(0xffff) : static_cast<__mmask16>((1u << (count - i)) - 1u);
+        const __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, x + i), tx);
+        const __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, y + i), ty);
+        const __m512 dz = DIMENSION == 3 ? _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, z + i), tz) : zero;
+        const __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, DIMENSION == 3 ? _mm512_fmadd_ps(dz, dz, eps2) : eps2));
+
+        // 14 bit estimate refined with one Newton-Raphson step
+        __m512 inv = _mm512_rsqrt14_ps(r2);
+        inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(inv, inv), three_halves));
+        inv = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ), inv);
+
+        const __m512 strength = _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, mass + i), _mm512_mul_ps(inv, _mm512_mul_ps(inv, inv)));
+        ax = _mm512_fmadd_ps(dx, strength, ax);
+        ay = _mm512_fmadd_ps(dy, strength, ay);
+        az = DIMENSION == 3 ? _mm512_fmadd_ps(dz, strength, az) : az;
+    }
+
+    return {_mm512_reduce_add_ps(ax), _mm512_reduce_add_ps(ay), _mm512_reduce_add_ps(az)};
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx2,fma")))
+glm::vec3 Kernel::evaluate_pairs_avx2(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared) {
+    const __m256 tx = _mm256_set1_ps(target.x);
+    const __m256 ty = _mm256_set1_ps(target.y);
+    const __m256 tz = _mm256_set1_ps(target.z);
+    const __m256 tm = _mm256_set1_ps(target_mass);
+    const __m256 eps2 = _mm256_set1_ps(softening_squared);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 sum_x = zero, sum_y = zero, sum_z = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), tx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), ty);
+        const __m256 dz = DIMENSION == 3 ? _mm256_sub_ps(_mm256_loadu_ps(z + i), tz) : zero;
+        const __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, DIMENSION == 3 ? _mm256_fmadd_ps(dz, dz, eps2) : eps2));
+
+        __m256 inv = _mm256_rsqrt_ps(r2);
+        inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(inv, inv), three_halves));
+        inv = _mm256_and_ps(inv, _mm256_cmp_ps(r2, zero, _CMP_GT_OQ));
+        const __m256 inv_cube = _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv));
+
+        const __m256 strength = _mm256_mul_ps(_mm256_loadu_ps(mass + i), inv_cube);
+        sum_x = _mm256_fmadd_ps(dx, strength, sum_x);
+        sum_y = _mm256_fmadd_ps(dy, strength, sum_y);
+        sum_z = DIMENSION == 3 ? _mm256_fmadd_ps(dz, strength, sum_z) : sum_z;
+
+        const __m256 reaction = _mm256_mul_ps(tm, inv_cube);
+        _mm256_storeu_ps(ax + i, _mm256_fnmadd_ps(dx, reaction, _mm256_loadu_ps(ax + i)));
+        _mm256_storeu_ps(ay + i, _mm256_fnmadd_ps(dy, reaction, _mm256_loadu_ps(ay + i)));
+        if constexpr (DIMENSION == 3) {
+            _mm256_storeu_ps(az + i, _mm256_fnmadd_ps(dz, reaction, _mm256_loadu_ps(az + i)));
+        }
+    }
+
+    const glm::vec3 tail = evaluate_pairs_scalar<DIMENSION>(target, target_mass, x + i, y + i, z + i, mass + i, ax + i, ay + i, az + i, count - i, softening_squared);
+    return glm::vec3(horizontal_sum(sum_x), horizontal_sum(sum_y), horizontal_sum(sum_z)) + tail;
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx512f")))
+glm::vec3 Kernel::evaluate_pairs_avx512(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared) {
+    const __m512 tx = _mm512_set1_ps(target.x);
+    const __m512 ty = _mm512_set1_ps(target.y);
+    const __m512 tz = _mm512_set1_ps(target.z);
+    const __m512 tm = _mm512_set1_ps(target_mass);
+    const __m512 eps2 = _mm512_set1_ps(softening_squared);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 zero = _mm512_setzero_ps();
+
+    __m512 sum_x = zero, sum_y = zero, sum_z = zero;
+    for (size_t i = 0; i < count; i += 16) {
+        const __mmask16 lanes = count - i >= 16 ? __mmask16(0xffff) : static_cast<__mmask16>((1u << (count - i)) - 1u);
+        const __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, x + i), tx);
+        const __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, y + i), ty);
+        const __m512 dz = DIMENSION == 3 ? _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, z + i), tz) : zero;
+        const __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, DIMENSION == 3 ? _mm512_fmadd_ps(dz, dz, eps2) : eps2));
+
+        __m512 inv = _mm512_rsqrt14_ps(r2);
+        inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(inv, inv), three_halves));
+        inv = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ), inv);
+        const __m512 inv_cube = _mm512_mul_ps(inv, _mm512_mul_ps(inv, inv));
+
+        const __m512 strength = _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, mass + i), inv_cube);
+        sum_x = _mm512_fmadd_ps(dx, strength, sum_x);
+        sum_y = _mm512_fmadd_ps(dy, strength, sum_y);
+        sum_z = DIMENSION == 3 ? _mm512_fmadd_ps(dz, strength, sum_z) : sum_z;
+
+        // Masked out lanes are neither read nor written back
+        const __m512 reaction = _mm512_mul_ps(tm, inv_cube);
+        _mm512_mask_storeu_ps(ax + i, lanes, _mm512_fnmadd_ps(dx, reaction, _mm512_maskz_loadu_ps(lanes, ax + i)));
+        _mm512_mask_storeu_ps(ay + i, lanes, _mm512_fnmadd_ps(dy, reaction, _mm512_maskz_loadu_ps(lanes, ay + i)));
+        if constexpr (DIMENSION == 3) {
+            _mm512_mask_storeu_ps(az + i, lanes, _mm512_fnmadd_ps(dz, reaction, _mm512_maskz_loadu_ps(lanes, az + i)));
+        }
+    }
+
+    return {_mm512_reduce_add_ps(sum_x), _mm512_reduce_add_ps(sum_y), _mm512_reduce_add_ps(sum_z)};
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx2,fma")))
+glm::vec3 Kernel::evaluate_short_range_avx2(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split) {
+    const __m256 tx = _mm256_set1_ps(target.x);
+    const __m256 ty = _mm256_set1_ps(target.y);
+    const __m256 tz = _mm256_set1_ps(target.z);
+    const __m256 eps2 = _mm256_set1_ps(softening_squared);
+    const __m256 scale = _mm256_set1_ps(0.5f / split);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 ax = zero, ay = zero, az = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), tx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), ty);
+        const __m256 dz = DIMENSION == 3 ? _mm256_sub_ps(_mm256_loadu_ps(z + i), tz) : zero;
+        const __m256 s2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, DIMENSION == 3 ? _mm256_fmadd_ps(dz, dz, eps2) : eps2));
+
+        __m256 inv = _mm256_rsqrt_ps(s2);
+        inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, s2), _mm256_mul_ps(inv, inv), three_halves));
+        inv = _mm256_and_ps(inv, _mm256_cmp_ps(s2, zero, _CMP_GT_OQ));
+
+        // 1 - u^3 Q(u^2) with u from the softened distance s^2 / s, zero past the cutoff
+        const __m256 u = _mm256_mul_ps(_mm256_mul_ps(s2, inv), scale);
+        const __m256 u_squared = _mm256_mul_ps(u, u);
+        __m256 series = _mm256_set1_ps(SHORT_RANGE_Q[7]);
+        for (int k = 6; k >= 0; --k) {
+            series = _mm256_fmadd_ps(series, u_squared, _mm256_set1_ps(SHORT_RANGE_Q[k]));
+        }
+        __m256 factor = _mm256_fnmadd_ps(_mm256_mul_ps(u, u_squared), series, one);
+        factor = _mm256_and_ps(factor, _mm256_cmp_ps(u_squared, _mm256_set1_ps(SHORT_RANGE_MAX_SQUARED), _CMP_LT_OQ));
+
+        const __m256 strength = _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(mass + i), factor), _mm256_mul_ps(inv, _mm256_mul_ps(inv, inv)));
+        ax = _mm256_fmadd_ps(dx, strength, ax);
+        ay = _mm256_fmadd_ps(dy, strength, ay);
+        az = DIMENSION == 3 ? _mm256_fmadd_ps(dz, strength, az) : az;
+    }
+
+    const glm::vec3 tail = evaluate_short_range_scalar<DIMENSION>(target, x + i, y + i, z + i, mass + i, count - i, softening_squared, split);
+    return glm::vec3(horizontal_sum(ax), horizontal_sum(ay), horizontal_sum(az)) + tail;
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx512f")))
+glm::vec3 Kernel::evaluate_short_range_avx512(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split) {
+    const __m512 tx = _mm512_set1_ps(target.x);
+    const __m512 ty = _mm512_set1_ps(target.y);
+    const __m512 tz = _mm512_set1_ps(target.z);
+    const __m512 eps2 = _mm512_set1_ps(softening_squared);
+    const __m512 scale = _mm512_set1_ps(0.5f / split);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 zero = _mm512_setzero_ps();
+
+    __m512 ax = zero, ay = zero, az = zero;
+    for (size_t i = 0; i < count; i += 16) {
+        const __mmask16 lanes = count - i >= 16 ? __mmask16(0xffff) : static_cast<__mmask16>((1u << (count - i)) - 1u);
+        const __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, x + i), tx);
+        const __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, y + i), ty);
+        const __m512 dz = DIMENSION == 3 ? _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, z + i), tz) : zero;
+        const __m512 s2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, DIMENSION == 3 ? _mm512_fmadd_ps(dz, dz, eps2) : eps2));
+
+        __m512 inv = _mm512_rsqrt14_ps(s2);
+        inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(half, s2), _mm512_mul_ps(inv, inv), three_halves));
+        inv = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(s2, zero, _CMP_GT_OQ), inv);
+
+        const __m512 u = _mm512_mul_ps(_mm512_mul_ps(s2, inv), scale);
+        const __m512 u_squared = _mm512_mul_ps(u, u);
+        __m512 series = _mm512_set1_ps(SHORT_RANGE_Q[7]);
+        for (int k = 6; k >= 0; --k) {
+            series = _mm512_fmadd_ps(series, u_squared, _mm512_set1_ps(SHORT_RANGE_Q[k]));
+        }
+        const __mmask16 within = _mm512_cmp_ps_mask(u_squared, _mm512_set1_ps(SHORT_RANGE_MAX_SQUARED), _CMP_LT_OQ);
+        const __m512 factor = _mm512_maskz_fnmadd_ps(within, _mm512_mul_ps(u, u_squared), series, one);
+
+        const __m512 strength = _mm512_mul_ps(_mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, mass + i), factor), _mm512_mul_ps(inv, _mm512_mul_ps(inv, inv)));
+        ax = _mm512_fmadd_ps(dx, strength, ax);
+        ay = _mm512_fmadd_ps(dy, strength, ay);
+        az = DIMENSION == 3 ? _mm512_fmadd_ps(dz, strength, az) : az;
+    }
+
+    return {_mm512_reduce_add_ps(ax), _mm512_reduce_add_ps(ay), _mm512_reduce_add_ps(az)};
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx2,fma")))
+glm::vec3 Kernel::evaluate_multipoles_avx2(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree) {
+    const __m256 tx = _mm256_set1_ps(target.x);
+    const __m256 ty = _mm256_set1_ps(target.y);
+    const __m256 tz = _mm256_set1_ps(target.z);
+    const __m256 eps2 = _mm256_set1_ps(softening_squared);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sixth = _mm256_set1_ps(1.0f / 6.0f);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const auto& q = sources.quadrupole;
+    const auto& o = sources.octupole;
+    const size_t count = sources.size();
+
+    __m256 ax = zero, ay = zero, az = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 rx = _mm256_sub_ps(tx, _mm256_loadu_ps(sources.position[0].data() + i));
+        const __m256 ry = _mm256_sub_ps(ty, _mm256_loadu_ps(sources.position[1].data() + i));
+        const __m256 rz = DIMENSION == 3 ? _mm256_sub_ps(tz, _mm256_loadu_ps(sources.position[2].data() + i)) : zero;
+        const __m256 r2 = _mm256_fmadd_ps(rx, rx, _mm256_fmadd_ps(ry, ry, DIMENSION == 3 ? _mm256_fmadd_ps(rz, rz, eps2) : eps2));
+
+        __m256 inv = _mm256_rsqrt_ps(r2);
+        inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(inv, inv), three_halves));
+        const __m256 inv_squared = _mm256_mul_ps(inv, inv);
+        const __m256 d1 = _mm256_sub_ps(zero, _mm256_mul_ps(inv, inv_squared));
+        const __m256 d2 = _mm256_mul_ps(_mm256_set1_ps(-3.0f), _mm256_mul_ps(d1, inv_squared));
+        const __m256 d3 = _mm256_mul_ps(_mm256_set1_ps(-5.0f), _mm256_mul_ps(d2, inv_squared));
+
+        __m256 moments[10];
+        for (size_t k = 0; k < 6; ++k) {
+            moments[k] = _mm256_loadu_ps(q[k].data() + i);
+        }
+        // The moments along z of planar cells are zero, the planar sums drop them
+        const __m256 qx = DIMENSION == 3 ? _mm256_fmadd_ps(moments[0], rx, _mm256_fmadd_ps(moments[1], ry, _mm256_mul_ps(moments[2], rz))) : _mm256_fmadd_ps(moments[0], rx, _mm256_mul_ps(moments[1], ry));
+        const __m256 qy = DIMENSION == 3 ? _mm256_fmadd_ps(moments[1], rx, _mm256_fmadd_ps(moments[3], ry, _mm256_mul_ps(moments[4], rz))) : _mm256_fmadd_ps(moments[1], rx, _mm256_mul_ps(moments[3], ry));
+        const __m256 qz = DIMENSION == 3 ? _mm256_fmadd_ps(moments[2], rx, _mm256_fmadd_ps(moments[4], ry, _mm256_mul_ps(moments[5], rz))) : zero;
+        const __m256 trace = DIMENSION == 3 ? _mm256_add_ps(_mm256_add_ps(moments[0], moments[3]), moments[5]) : _mm256_add_ps(moments[0], moments[3]);
+        const __m256 rqr = DIMENSION == 3 ? _mm256_fmadd_ps(rx, qx, _mm256_fmadd_ps(ry, qy, _mm256_mul_ps(rz, qz))) : _mm256_fmadd_ps(rx, qx, _mm256_mul_ps(ry, qy));
+
+        __m256 radial = _mm256_fmadd_ps(_mm256_loadu_ps(sources.mass.data() + i), d1, _mm256_mul_ps(half, _mm256_fmadd_ps(d2, trace, _mm256_mul_ps(d3, rqr))));
+        __m256 acceleration_x = _mm256_mul_ps(d2, qx);
+        __m256 acceleration_y = _mm256_mul_ps(d2, qy);
+        __m256 acceleration_z = _mm256_mul_ps(d2, qz);
+
+        if (degree >= 3) {
+            const __m256 d4 = _mm256_mul_ps(_mm256_set1_ps(-7.0f), _mm256_mul_ps(d3, inv_squared));
+            for (size_t k = 0; k < 10; ++k) {
+                moments[k] = _mm256_loadu_ps(o[k].data() + i);
+            }
+            const __m256 xx = _mm256_mul_ps(rx, rx);
+            const __m256 yy = _mm256_mul_ps(ry, ry);
+            const __m256 zz = _mm256_mul_ps(rz, rz);
+            const __m256 two = _mm256_set1_ps(2.0f);
+            const __m256 xy = _mm256_mul_ps(two, _mm256_mul_ps(rx, ry));
+            const __m256 xz = _mm256_mul_ps(two, _mm256_mul_ps(rx, rz));
+            const __m256 yz = _mm256_mul_ps(two, _mm256_mul_ps(ry, rz));
+
+            const __m256 orr_x = DIMENSION == 3 ? _mm256_fmadd_ps(moments[0], xx, _mm256_fmadd_ps(moments[3], yy, _mm256_fmadd_ps(moments[5], zz, _mm256_fmadd_ps(moments[1], xy, _mm256_fmadd_ps(moments[2], xz, _mm256_mul_ps(moments[4], yz))))))
+                                                : _mm256_fmadd_ps(moments[0], xx, _mm256_fmadd_ps(moments[3], yy, _mm256_mul_ps(moments[1], xy)));
+            const __m256 orr_y = DIMENSION == 3 ? _mm256_fmadd_ps(moments[1], xx, _mm256_fmadd_ps(moments[6], yy, _mm256_fmadd_ps(moments[8], zz, _mm256_fmadd_ps(moments[3], xy, _mm256_fmadd_ps(moments[4], xz, _mm256_mul_ps(moments[7], yz))))))
+                                                : _mm256_fmadd_ps(moments[1], xx, _mm256_fmadd_ps(moments[6], yy, _mm256_mul_ps(moments[3], xy)));
+            const __m256 orr_z = DIMENSION == 3 ? _mm256_fmadd_ps(moments[2], xx, _mm256_fmadd_ps(moments[7], yy, _mm256_fmadd_ps(moments[9], zz, _mm256_fmadd_ps(moments[4], xy, _mm256_fmadd_ps(moments[5], xz, _mm256_mul_ps(moments[8], yz)))))) : zero;
+            const __m256 trace_x = DIMENSION == 3 ? _mm256_add_ps(_mm256_add_ps(moments[0], moments[3]), moments[5]) : _mm256_add_ps(moments[0], moments[3]);
+            const __m256 trace_y = DIMENSION == 3 ? _mm256_add_ps(_mm256_add_ps(moments[1], moments[6]), moments[8]) : _mm256_add_ps(moments[1], moments[6]);
+            const __m256 trace_z = DIMENSION == 3 ? _mm256_add_ps(_mm256_add_ps(moments[2], moments[7]), moments[9]) : zero;
+            const __m256 orrr = DIMENSION == 3 ? _mm256_fmadd_ps(rx, orr_x, _mm256_fmadd_ps(ry, orr_y, _mm256_mul_ps(rz, orr_z))) : _mm256_fmadd_ps(rx, orr_x, _mm256_mul_ps(ry, orr_y));
+            const __m256 tr = DIMENSION == 3 ? _mm256_fmadd_ps(rx, trace_x, _mm256_fmadd_ps(ry, trace_y, _mm256_mul_ps(rz, trace_z))) : _mm256_fmadd_ps(rx, trace_x, _mm256_mul_ps(ry, trace_y));
+
+            const __m256 half_d2 = _mm256_mul_ps(half, d2);
+            const __m256 half_d3 = _mm256_mul_ps(half, d3);
+            radial = _mm256_fnmadd_ps(half_d3, tr, _mm256_fnmadd_ps(_mm256_mul_ps(sixth, d4), orrr, radial));
+            acceleration_x = _mm256_fnmadd_ps(half_d2, trace_x, _mm256_fnmadd_ps(half_d3, orr_x, acceleration_x));
+            acceleration_y = _mm256_fnmadd_ps(half_d2, trace_y, _mm256_fnmadd_ps(half_d3, orr_y, acceleration_y));
+            acceleration_z = DIMENSION == 3 ? _mm256_fnmadd_ps(half_d2, trace_z, _mm256_fnmadd_ps(half_d3, orr_z, acceleration_z)) : acceleration_z;
+        }
+
+        ax = _mm256_add_ps(ax, _mm256_fmadd_ps(radial, rx, acceleration_x));
+        ay = _mm256_add_ps(ay, _mm256_fmadd_ps(radial, ry, acceleration_y));
+        az = DIMENSION == 3 ? _mm256_add_ps(az, _mm256_fmadd_ps(radial, rz, acceleration_z)) : az;
+    }
+
+    const glm::vec3 tail = multipoles_scalar<DIMENSION>(target, sources, i, softening_squared, degree);
+    return glm::vec3(horizontal_sum(ax), horizontal_sum(ay), horizontal_sum(az)) + tail;
+}
+
+template <u_int DIMENSION>
+__attribute__((target("avx512f")))
+glm::vec3 Kernel::evaluate_multipoles_avx512(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree) {
+    const __m512 tx = _mm512_set1_ps(target.x);
+    const __m512 ty = _mm512_set1_ps(target.y);
+    const __m512 tz = _mm512_set1_ps(target.z);
+    const __m512 eps2 = _mm512_set1_ps(softening_squared);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 sixth = _mm512_set1_ps(1.0f / 6.0f);
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 zero = _mm512_setzero_ps();
+    const auto& q = sources.quadrupole;
+    const auto& o = sources.octupole;
+    const size_t count = sources.size();
+
+    __m512 ax = zero, ay = zero, az = zero;
+    for (size_t i = 0; i < count; i += 16) {
+        // Masked out lanes load zero moments and contribute nothing
+        const __mmask16 lanes = count - i >= 16 ? __mmask16(0xffff) : static_cast<__mmask16>((1u << (count - i)) - 1u);
+        const __m512 rx = _mm512_sub_ps(tx, _mm512_maskz_loadu_ps(lanes, sources.position[0].data() + i));
+        const __m512 ry = _mm512_sub_ps(ty, _mm512_maskz_loadu_ps(lanes, sources.position[1].data() + i));
+        const __m512 rz = DIMENSION == 3 ? _mm512_sub_ps(tz, _mm512_maskz_loadu_ps(lanes, sources.position[2].data() + i)) : zero;
+        const __m512 r2 = _mm512_fmadd_ps(rx, rx, _mm512_fmadd_ps(ry, ry, DIMENSION == 3 ? _mm512_fmadd_ps(rz, rz, eps2) : eps2));
+
+        __m512 inv = _mm512_rsqrt14_ps(r2);
+        inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(inv, inv), three_halves));
+        const __m512 inv_squared = _mm512_mul_ps(inv, inv);
+        const __m512 d1 = _mm512_sub_ps(zero, _mm512_mul_ps(inv, inv_squared));
+        const __m512 d2 = _mm512_mul_ps(_mm512_set1_ps(-3.0f), _mm512_mul_ps(d1, inv_squared));
+        const __m512 d3 = _mm512_mul_ps(_mm512_set1_ps(-5.0f), _mm512_mul_ps(d2, inv_squared));
+
+        __m512 moments[10];
+        for (size_t k = 0; k < 6; ++k) {
+            moments[k] = _mm512_maskz_loadu_ps(lanes, q[k].data() + i);
+        }
+        // The moments along z of planar cells are zero, the planar sums drop them
+        const __m512 qx = DIMENSION == 3 ? _mm512_fmadd_ps(moments[0], rx, _mm512_fmadd_ps(moments[1], ry, _mm512_mul_ps(moments[2], rz))) : _mm512_fmadd_ps(moments[0], rx, _mm512_mul_ps(moments[1], ry));
+        const __m512 qy = DIMENSION == 3 ? _mm512_fmadd_ps(moments[1], rx, _mm512_fmadd_ps(moments[3], ry, _mm512_mul_ps(moments[4], rz))) : _mm512_fmadd_ps(moments[1], rx, _mm512_mul_ps(moments[3], ry));
+        const __m512 qz = DIMENSION == 3 ? _mm512_fmadd_ps(moments[2], rx, _mm512_fmadd_ps(moments[4], ry, _mm512_mul_ps(moments[5], rz))) : zero;
+        const __m512 trace = DIMENSION == 3 ? _mm512_add_ps(_mm512_add_ps(moments[0], moments[3]), moments[5]) : _mm512_add_ps(moments[0], moments[3]);
+        const __m512 rqr = DIMENSION == 3 ? _mm512_fmadd_ps(rx, qx, _mm512_fmadd_ps(ry, qy, _mm512_mul_ps(rz, qz))) : _mm512_fmadd_ps(rx, qx, _mm512_mul_ps(ry, qy));
+
+        __m512 radial = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(lanes, sources.mass.data() + i), d1, _mm512_mul_ps(half, _mm512_fmadd_ps(d2, trace, _mm512_mul_ps(d3, rqr))));
+        __m512 acceleration_x = _mm512_mul_ps(d2, qx);
+        __m512 acceleration_y = _mm512_mul_ps(d2, qy);
+        __m512 acceleration_z = _mm512_mul_ps(d2, qz);
+
+        if (degree >= 3) {
+            const __m512 d4 = _mm512_mul_ps(_mm512_set1_ps(-7.0f), _mm512_mul_ps(d3, inv_squared));
+            for (size_t k = 0; k < 10; ++k) {
+                moments[k] = _mm512_maskz_loadu_ps(lanes, o[k].data() + i);
+            }
+            const __m512 xx = _mm512_mul_ps(rx, rx);
+            const __m512 yy = _mm512_mul_ps(ry, ry);
+            const __m512 zz = _mm512_mul_ps(rz, rz);
+            const __m512 two = _mm512_set1_ps(2.0f);
+            const __m512 xy = _mm512_mul_ps(two, _mm512_mul_ps(rx, ry));
+            const __m512 xz = _mm512_mul_ps(two, _mm512_mul_ps(rx, rz));
+            const __m512 yz = _mm512_mul_ps(two, _mm512_mul_ps(ry, rz));
+
+            const __m512 orr_x = DIMENSION == 3 ? _mm512_fmadd_ps(moments[0], xx, _mm512_fmadd_ps(moments[3], yy, _mm512_fmadd_ps(moments[5], zz, _mm512_fmadd_ps(moments[1], xy, _mm512_fmadd_ps(moments[2], xz, _mm512_mul_ps(moments[4], yz))))))
+                                                : _mm512_fmadd_ps(moments[0], xx, _mm512_fmadd_ps(moments[3], yy, _mm512_mul_ps(moments[1], xy)));
+            const __m512 orr_y = DIMENSION == 3 ? _mm512_fmadd_ps(moments[1], xx, _mm512_fmadd_ps(moments[6], yy, _mm512_fmadd_ps(moments[8], zz, _mm512_fmadd_ps(moments[3], xy, _mm512_fmadd_ps(moments[4], xz, _mm512_mul_ps(moments[7], yz))))))
+                                                : _mm512_fmadd_ps(moments[1], xx, _mm512_fmadd_ps(moments[6], yy, _mm512_mul_ps(moments[3], xy)));
+            const __m512 orr_z = DIMENSION == 3 ? _mm512_fmadd_ps(moments[2], xx, _mm512_fmadd_ps(moments[7], yy, _mm512_fmadd_ps(moments[9], zz, _mm512_fmadd_ps(moments[4], xy, _mm512_fmadd_ps(moments[5], xz, _mm512_mul_ps(moments[8], yz)))))) : zero;
+            const __m512 trace_x = DIMENSION == 3 ? _mm512_add_ps(_mm512_add_ps(moments[0], moments[3]), moments[5]) : _mm512_add_ps(moments[0], moments[3]);
+            const __m512 trace_y = DIMENSION == 3 ? _mm512_add_ps(_mm512_add_ps(moments[1], moments[6]), moments[8]) : _mm512_add_ps(moments[1], moments[6]);
+            const __m512 trace_z = DIMENSION == 3 ? _mm512_add_ps(_mm512_add_ps(moments[2], moments[7]), moments[9]) : zero;
+            const __m512 orrr = DIMENSION == 3 ? _mm512_fmadd_ps(rx, orr_x, _mm512_fmadd_ps(ry, orr_y, _mm512_mul_ps(rz, orr_z))) : _mm512_fmadd_ps(rx, orr_x, _mm512_mul_ps(ry, orr_y));
+            const __m512 tr = DIMENSION == 3 ? _mm512_fmadd_ps(rx, trace_x, _mm512_fmadd_ps(ry, trace_y, _mm512_mul_ps(rz, trace_z))) : _mm512_fmadd_ps(rx, trace_x, _mm512_mul_ps(ry, trace_y));
+
+            const __m512 half_d2 = _mm512_mul_ps(half, d2);
+            const __m512 half_d3 = _mm512_mul_ps(half, d3);
+            radial = _mm512_fnmadd_ps(half_d3, tr, _mm512_fnmadd_ps(_mm512_mul_ps(sixth, d4), orrr, radial));
+            acceleration_x = _mm512_fnmadd_ps(half_d2, trace_x, _mm512_fnmadd_ps(half_d3, orr_x, acceleration_x));
+            acceleration_y = _mm512_fnmadd_ps(half_d2, trace_y, _mm512_fnmadd_ps(half_d3, orr_y, acceleration_y));
+            acceleration_z = DIMENSION == 3 ? _mm512_fnmadd_ps(half_d2, trace_z, _mm512_fnmadd_ps(half_d3, orr_z, acceleration_z)) : acceleration_z;
+        }
+
+        ax = _mm512_add_ps(ax, _mm512_fmadd_ps(radial, rx, acceleration_x));
+        ay = _mm512_add_ps(ay, _mm512_fmadd_ps(radial, ry, acceleration_y));
+        az = DIMENSION == 3 ? _mm512_add_ps(az, _mm512_fmadd_ps(radial, rz, acceleration_z)) : az;
+    }
+
+    return {_mm512_reduce_add_ps(ax), _mm512_reduce_add_ps(ay), _mm512_reduce_add_ps(az)};
+}
+
+__attribute__((target("avx2,fma")))
+Kernel::Derivatives Kernel::evaluate_jerk_avx2(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared) {
+    const __m256 tx = _mm256_set1_ps(target.x);
+    const __m256 ty = _mm256_set1_ps(target.y);
+    const __m256 tz = _mm256_set1_ps(target.z);
+    const __m256 tvx = _mm256_set1_ps(target_velocity.x);
+    const __m256 tvy = _mm256_set1_ps(target_velocity.y);
+    const __m256 tvz = _mm256_set1_ps(target_velocity.z);
+    const __m256 eps2 = _mm256_set1_ps(softening_squared);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 ax = zero, ay = zero, az = zero;
+    __m256 jx = zero, jy = zero, jz = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), tx);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), ty);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), tz);
+        const __m256 dvx = _mm256_sub_ps(_mm256_loadu_ps(vx + i), tvx);
+        const __m256 dvy = _mm256_sub_ps(_mm256_loadu_ps(vy + i), tvy);
+        const __m256 dvz = _mm256_sub_ps(_mm256_loadu_ps(vz + i), tvz);
+        const __m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, eps2)));
+
+        __m256 inv = _mm256_rsqrt_ps(r2);
+        inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, r2), _mm256_mul_ps(inv, inv), three_halves));
+        inv = _mm256_and_ps(inv, _mm256_cmp_ps(r2, zero, _CMP_GT_OQ));
+        const __m256 inv_squared = _mm256_mul_ps(inv, inv);
+        const __m256 strength = _mm256_mul_ps(_mm256_loadu_ps(mass + i), _mm256_mul_ps(inv, inv_squared));
+        ax = _mm256_fmadd_ps(dx, strength, ax);
+        ay = _mm256_fmadd_ps(dy, strength, ay);
+        az = _mm256_fmadd_ps(dz, strength, az);
+
+        // m / s^3 (v - 3 (r . v) / s^2 r)
+        const __m256 radial = _mm256_mul_ps(three, _mm256_mul_ps(inv_squared, _mm256_fmadd_ps(dx, dvx, _mm256_fmadd_ps(dy, dvy, _mm256_mul_ps(dz, dvz)))));
+        jx = _mm256_fmadd_ps(strength, _mm256_fnmadd_ps(radial, dx, dvx), jx);
+        jy = _mm256_fmadd_ps(strength, _mm256_fnmadd_ps(radial, dy, dvy), jy);
+        jz = _mm256_fmadd_ps(strength, _mm256_fnmadd_ps(radial, dz, dvz), jz);
+    }
+
+    Derivatives result = evaluate_jerk_scalar(target, target_velocity, x + i, y + i, z + i, vx + i, vy + i, vz + i, mass + i, count - i, softening_squared);
+    result.acceleration += glm::vec3(horizontal_sum(ax), horizontal_sum(ay), horizontal_sum(az));
+    result.jerk += glm::vec3(horizontal_sum(jx), horizontal_sum(jy), horizontal_sum(jz));
+    return result;
+}
+
+__attribute__((target("avx512f")))
+Kernel::Derivatives Kernel::evaluate_jerk_avx512(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared) {
+    const __m512 tx = _mm512_set1_ps(target.x);
+    const __m512 ty = _mm512_set1_ps(target.y);
+    const __m512 tz = _mm512_set1_ps(target.z);
+    const __m512 tvx = _mm512_set1_ps(target_velocity.x);
+    const __m512 tvy = _mm512_set1_ps(target_velocity.y);
+    const __m512 tvz = _mm512_set1_ps(target_velocity.z);
+    const __m512 eps2 = _mm512_set1_ps(softening_squared);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three = _mm512_set1_ps(3.0f);
+    const __m512 three_halves = _mm512_set1_ps(1.5f);
+    const __m512 zero = _mm512_setzero_ps();
+
+    __m512 ax = zero, ay = zero, az = zero;
+    __m512 jx = zero, jy = zero, jz = zero;
+    for (size_t i = 0; i < count; i += 16) {
+        const __mmask16 lanes = count - i >= 16 ? __mmask16(0xffff) : static_cast<__mmask16>((1u << (count - i)) - 1u);
+        const __m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, x + i), tx);
+        const __m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, y + i), ty);
+        const __m512 dz = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, z + i), tz);
+        const __m512 dvx = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, vx + i), tvx);
+        const __m512 dvy = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, vy + i), tvy);
+        const __m512 dvz = _mm512_sub_ps(_mm512_maskz_loadu_ps(lanes, vz + i), tvz);
+        const __m512 r2 = _mm512_fmadd_ps(dx, dx, _mm512_fmadd_ps(dy, dy, _mm512_fmadd_ps(dz, dz, eps2)));
+
+        __m512 inv = _mm512_rsqrt14_ps(r2);
+        inv = _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(half, r2), _mm512_mul_ps(inv, inv), three_halves));
+        inv = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ), inv);
+        const __m512 inv_squared = _mm512_mul_ps(inv, inv);
+        const __m512 strength = _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, mass + i), _mm512_mul_ps(inv, inv_squared));
+        ax = _mm512_fmadd_ps(dx, strength, ax);
+        ay = _mm512_fmadd_ps(dy, strength, ay);
+        az = _mm512_fmadd_ps(dz, strength, az);
+
+        // m / s^3 (v - 3 (r . v) / s^2 r)
+        const __m512 radial = _mm512_mul_ps(three, _mm512_mul_ps(inv_squared, _mm512_fmadd_ps(dx, dvx, _mm512_fmadd_ps(dy, dvy, _mm512_mul_ps(dz, dvz)))));
+        jx = _mm512_fmadd_ps(strength, _mm512_fnmadd_ps(radial, dx, dvx), jx);
+        jy = _mm512_fmadd_ps(strength, _mm512_fnmadd_ps(radial, dy, dvy), jy);
+        jz = _mm512_fmadd_ps(strength, _mm512_fnmadd_ps(radial, dz, dvz), jz);
+    }
+
+    Derivatives result;
+    result.acceleration = glm::vec3(_mm512_reduce_add_ps(ax), _mm512_reduce_add_ps(ay), _mm512_reduce_add_ps(az));
+    result.jerk = glm::vec3(_mm512_reduce_add_ps(jx), _mm512_reduce_add_ps(jy), _mm512_reduce_add_ps(jz));
+    return result;
+}
+
+#else
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_sse4(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    return evaluate_scalar<DIMENSION>(target, x, y, z, mass, count, softening_squared);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_avx2(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    return evaluate_scalar<DIMENSION>(target, x, y, z, mass, count, softening_squared);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_avx512(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared) {
+    return evaluate_scalar<DIMENSION>(target, x, y, z, mass, count, softening_squared);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_pairs_avx2(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared) {
+    return evaluate_pairs_scalar<DIMENSION>(target, target_mass, x, y, z, mass, ax, ay, az, count, softening_squared);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_pairs_avx512(const glm::vec3& target, float target_mass, const float* x, const float* y, const float* z, const float* mass, float* ax, float* ay, float* az, size_t count, float softening_squared) {
+    return evaluate_pairs_scalar<DIMENSION>(target, target_mass, x, y, z, mass, ax, ay, az, count, softening_squared);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_short_range_avx2(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split) {
+    return evaluate_short_range_scalar<DIMENSION>(target, x, y, z, mass, count, softening_squared, split);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_short_range_avx512(const glm::vec3& target, const float* x, const float* y, const float* z, const float* mass, size_t count, float softening_squared, float split) {
+    return evaluate_short_range_scalar<DIMENSION>(target, x, y, z, mass, count, softening_squared, split);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_multipoles_avx2(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree) {
+    return evaluate_multipoles_scalar<DIMENSION>(target, sources, softening_squared, degree);
+}
+
+template <u_int DIMENSION>
+glm::vec3 Kernel::evaluate_multipoles_avx512(const glm::vec3& target, const InteractionList& sources, float softening_squared, int degree) {
+    return evaluate_multipoles_scalar<DIMENSION>(target, sources, softening_squared, degree);
+}
+
+Kernel::Derivatives Kernel::evaluate_jerk_avx2(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared) {
+    return evaluate_jerk_scalar(target, target_velocity, x, y, z, vx, vy, vz, mass, count, softening_squared);
+}
+
+Kernel::Derivatives Kernel::evaluate_jerk_avx512(const glm::vec3& target, const glm::vec3& target_velocity, const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz, const float* mass, size_t count, float softening_squared) {
+    return evaluate_jerk_scalar(target, target_velocity, x, y, z, vx, vy, vz, mass, count, softening_squared);
+}
+
+#endif
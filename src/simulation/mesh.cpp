@@ -0,0 +1,257 @@
+/*
+ * @path src/simulation/mesh.cpp
+ * @file mesh.cpp
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include "simulation/mesh.hpp"
+
+bool Mesh::Parameters::operator==(const Parameters& other) const {
+    return size == other.size && cell_size == other.cell_size && softening == other.softening &&
+           split == other.split && assignment == other.assignment;
+}
+
+int Mesh::get_size() const {
+    return size;
+}
+
+float Mesh::get_cell_size() const {
+    return cell_size;
+}
+
+int Mesh::width() const {
+    return assignment == Assignment::TRIANGULAR_SHAPED_CLOUD ? 3 : 2;
+}
+
+Mesh::Stencil Mesh::stencil(float coordinate) const {
+    coordinate = std::clamp(coordinate, static_cast<float>(MARGIN), static_cast<float>(size - MARGIN));
+
+    Stencil result;
+    if (assignment == Assignment::TRIANGULAR_SHAPED_CLOUD) {
+        const float nearest = std::floor(coordinate + 0.5f);
+        const float offset = coordinate - nearest;
+        result.first = static_cast<int>(nearest) - 1;
+        result.weights = {0.5f * (0.5f - offset) * (0.5f - offset), 0.75f - offset * offset, 0.5f * (0.5f + offset) * (0.5f + offset)};
+    } else {
+        const float lower = std::floor(coordinate);
+        const float offset = coordinate - lower;
+        result.first = static_cast<int>(lower);
+        result.weights = {1.0f - offset, offset, 0.0f};
+    }
+    return result;
+}
+
+void Mesh::assign(const BodyStore& bodies, size_t count, const Bound& bound, int size, Assignment assignment, bool bounded) {
+    int rounded = MIN_SIZE;
+    while (rounded < std::min(size, MAX_SIZE)) {
+        rounded <<= 1;
+    }
+    this->size = rounded;
+    this->assignment = assignment;
+
+    // The bound covers the nodes inside the margins
+    cell_size = 2.0f * bound.half_width / static_cast<float>(this->size - 2 * MARGIN);
+    origin = bound.center - glm::vec3(bound.half_width + static_cast<float>(MARGIN) * cell_size);
+
+    const auto n = static_cast<size_t>(this->size);
+    const size_t padded = 2 * n;
+    fft.prepare(padded);
+    grid.resize(padded * padded * padded);
+    for (auto& component : forces) {
+        component.resize(n * n * n);
+    }
+
+    thread_grids.resize(omp_get_max_threads());
+    const float* x = bodies.position[0].data();
+    const float* y = bodies.position[1].data();
+    const float* z = bodies.position[2].data();
+    const float* mass = bodies.mass.data();
+    const float inv_cell_size = 1.0f / cell_size;
+    const int stencil_width = width();
+
+    // Every thread scatters into a grid of its own, no two threads write the same node
+    #pragma omp parallel
+    {
+        aligned_vector<float>& masses = thread_grids[omp_get_thread_num()];
+        masses.assign(n * n * n, 0.0f);
+
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(count); ++i) {
+            if (bounded && !bound.contains(glm::vec3(x[i], y[i], z[i]))) {
+                continue;
+            }
+            const Stencil sx = stencil((x[i] - origin.x) * inv_cell_size);
+            const Stencil sy = stencil((y[i] - origin.y) * inv_cell_size);
+            const Stencil sz = stencil((z[i] - origin.z) * inv_cell_size);
+
+            for (int a = 0; a < stencil_width; ++a) {
+                for (int b = 0; b < stencil_width; ++b) {
+                    const float weight = mass[i] * sx.weights[a] * sy.weights[b];
+                    float* line = masses.data() + (static_cast<size_t>(sx.first + a) * n + static_cast<size_t>(sy.first + b)) * n + sz.first;
+                    for (int c = 0; c < stencil_width; ++c) {
+                        line[c] += weight * sz.weights[c];
+                    }
+                }
+            }
+        }
+
+        // Sum the thread grids into the corner of the padded grid, the rest of the lines is zero
+        const auto team = static_cast<size_t>(omp_get_num_threads());
+        #pragma omp for schedule(static)
+        for (std::ptrdiff_t line = 0; line < static_cast<std::ptrdiff_t>(n * n); ++line) {
+            const size_t gx = static_cast<size_t>(line) / n;
+            const size_t gy = static_cast<size_t>(line) % n;
+            float* target = grid.data() + (gx * padded + gy) * padded;
+            std::fill(target, target + padded, 0.0f);
+
+            for (size_t thread = 0; thread < team; ++thread) {
+                const float* source = thread_grids[thread].data() + static_cast<size_t>(line) * n;
+                #pragma omp simd
+                for (size_t gz = 0; gz < n; ++gz) {
+                    target[gz] += source[gz];
+                }
+            }
+        }
+    }
+}
+
+void Mesh::prepare_green(const Parameters& requested) {
+    parameters = requested;
+
+    const auto n = static_cast<size_t>(size);
+    const size_t padded = 2 * n;
+    const size_t half_size = fft.get_half_size();
+    const double softening_squared = static_cast<double>(requested.softening) * requested.softening;
+    const double split = requested.split;
+    // Without softening the potential of a node on itself is taken at half a cell
+    const double minimum_squared = 0.25 * static_cast<double>(cell_size) * cell_size;
+
+    // Potential of a unit mass at the distance of every node, the far half of every axis holds
+    // the negative offsets of the isolated convolution
+    aligned_vector<float> potential(padded * padded * padded);
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t line = 0; line < static_cast<std::ptrdiff_t>(padded * padded); ++line) {
+        const size_t gx = static_cast<size_t>(line) / padded;
+        const size_t gy = static_cast<size_t>(line) % padded;
+        const double dx = static_cast<double>(std::min(gx, padded - gx));
+        const double dy = static_cast<double>(std::min(gy, padded - gy));
+
+        for (size_t gz = 0; gz < padded; ++gz) {
+            const double dz = static_cast<double>(std::min(gz, padded - gz));
+            const double distance = cell_size * std::sqrt(dx * dx + dy * dy + dz * dz);
+            double value = 0.0;
+            if (split > 0.0) {
+                // Long range part of the softened potential, the short range kernel takes the
+                // same softened distance, so the two add up to the Plummer softened interaction
+                const double softened = std::sqrt(distance * distance + softening_squared);
+                value = softened > 0.0 ? -std::erf(softened / (2.0 * split)) / softened : -1.0 / (std::sqrt(M_PI) * split);
+            } else {
+                value = -1.0 / std::sqrt(std::max(distance * distance + softening_squared, minimum_squared));
+            }
+            potential[static_cast<size_t>(line) * padded + gz] = static_cast<float>(value);
+        }
+    }
+
+    // The kernel is real and even, so is its spectrum
+    spectrum.resize(padded * padded * half_size);
+    fft.forward(potential.data(), spectrum.data(), padded);
+    green.resize(spectrum.size());
+
+    // The long range part has no power left at the grid scale, there the assignment and the
+    // interpolation are deconvolved so that the split stays exact
+    const int order = requested.assignment == Assignment::TRIANGULAR_SHAPED_CLOUD ? 3 : 2;
+    const auto window = [padded](size_t index) {
+        const double frequency = static_cast<double>(index <= padded / 2 ? index : padded - index);
+        const double phase = M_PI * frequency / static_cast<double>(padded);
+        return phase > 0.0 ? std::sin(phase) / phase : 1.0;
+    };
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t line = 0; line < static_cast<std::ptrdiff_t>(padded * padded); ++line) {
+        const size_t kx = static_cast<size_t>(line) / padded;
+        const size_t ky = static_cast<size_t>(line) % padded;
+        const double wxy = window(kx) * window(ky);
+
+        for (size_t kz = 0; kz < half_size; ++kz) {
+            const size_t index = static_cast<size_t>(line) * half_size + kz;
+            double value = spectrum[index].real();
+            if (split > 0.0) {
+                value /= std::pow(wxy * window(kz), 2 * order);
+            }
+            green[index] = static_cast<float>(value);
+        }
+    }
+}
+
+void Mesh::solve(float gravity, float softening, float split) {
+    const Parameters requested {size, cell_size, softening, split, assignment};
+    if (!(requested == parameters)) {
+        prepare_green(requested);
+    }
+
+    const auto n = static_cast<size_t>(size);
+    const size_t padded = 2 * n;
+
+    fft.forward(grid.data(), spectrum.data(), n);
+    const auto coefficients = static_cast<std::ptrdiff_t>(spectrum.size());
+    #pragma omp parallel for simd schedule(static)
+    for (std::ptrdiff_t i = 0; i < coefficients; ++i) {
+        spectrum[i] *= green[i];
+    }
+    fft.inverse(spectrum.data(), grid.data(), n);
+
+    // Fourth order central differences of the potential, nodes closer than two cells to a
+    // face are never reached by a stencil
+    const float factor = -gravity / (12.0f * cell_size);
+    const size_t strides[3] = {padded * padded, padded, 1};
+    const auto nodes = static_cast<std::ptrdiff_t>(n * n);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t line = 0; line < nodes; ++line) {
+        const size_t gx = static_cast<size_t>(line) / n;
+        const size_t gy = static_cast<size_t>(line) % n;
+        const bool inside = gx >= 2 && gx + 2 < n && gy >= 2 && gy + 2 < n;
+
+        for (int k = 0; k < 3; ++k) {
+            float* force = forces[k].data() + static_cast<size_t>(line) * n;
+            std::fill(force, force + n, 0.0f);
+            if (!inside) {
+                continue;
+            }
+
+            const float* potential = grid.data() + (gx * padded + gy) * padded;
+            const size_t stride = strides[k];
+            #pragma omp simd
+            for (size_t gz = 2; gz < n - 2; ++gz) {
+                force[gz] = factor * (8.0f * (potential[gz + stride] - potential[gz - stride]) - (potential[gz + 2 * stride] - potential[gz - 2 * stride]));
+            }
+        }
+    }
+}
+
+glm::vec3 Mesh::interpolate(const glm::vec3& position) const {
+    const glm::vec3 coordinate = (position - origin) / cell_size;
+    const Stencil sx = stencil(coordinate.x);
+    const Stencil sy = stencil(coordinate.y);
+    const Stencil sz = stencil(coordinate.z);
+
+    const auto n = static_cast<size_t>(size);
+    const int stencil_width = width();
+    glm::vec3 result(0.0f);
+
+    for (int a = 0; a < stencil_width; ++a) {
+        for (int b = 0; b < stencil_width; ++b) {
+            const float weight = sx.weights[a] * sy.weights[b];
+            const size_t line = (static_cast<size_t>(sx.first + a) * n + static_cast<size_t>(sy.first + b)) * n + sz.first;
+            for (int c = 0; c < stencil_width; ++c) {
+                const float node_weight = weight * sz.weights[c];
+                result.x += node_weight * forces[0][line + c];
+                result.y += node_weight * forces[1][line + c];
+                result.z += node_weight * forces[2][line + c];
+            }
+        }
+    }
+    return result;
+}
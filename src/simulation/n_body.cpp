@@ -3,9 +3,13 @@
  * @file n_body.cpp
 */
 
+#include <algorithm>
+#include <cmath>
+#include <random>
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
 #include "simulation/n_body.hpp"
+#include "simulation/kepler.hpp"
 
 void NBody::update_model_matrix() {
     model_matrix = glm::mat4(1.0f);
@@ -23,3 +27,647 @@ void NBody::set_paused(bool paused) {
 [[maybe_unused]] bool NBody::is_paused() const {
     return paused;
 }
+
+const char* const NBody::vertex_shader = 
+    R"(
+        #version 300 es
+        precision highp float;
+        layout(location = 0) in float a_position_x;
+        layout(location = 1) in float a_position_y;
+        layout(location = 2) in float a_position_z;
+        layout(location = 3) in vec3 a_color;
+
+        uniform mat4 u_view_projection;
+        out vec3 v_color;
+
+        void main(void) {
+            gl_Position = u_view_projection * vec4(a_position_x, a_position_y, a_position_z, 1.0);
+            v_color = a_color;
+            gl_PointSize = 2.0f;
+        }
+    )";
+
+const char* const NBody::fragment_shader = 
+    R"(
+        #version 300 es
+        precision highp float;
+        in vec3 v_color;
+        out vec4 frag_color;
+
+        void main(void) {
+            frag_color = vec4(v_color, 1.0f);
+        }
+    )";
+
+NBody::~NBody() {
+    if (vao != 0) {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &position_vbo);
+        glDeleteBuffers(1, &color_vbo);
+    }
+}
+
+void NBody::create_buffers() {
+    shader = std::make_unique<Shader>(vertex_shader, fragment_shader, false);
+
+    // Generate the VAO and VBOs, positions and colors are uploaded from separate arrays
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &position_vbo);
+    glGenBuffers(1, &color_vbo);
+
+    glBindVertexArray(vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    glBindVertexArray(0);
+}
+
+void NBody::update(const float& delta_time) {
+    // Accelerations left by another integrator may lack what this one keeps, e.g. the jerk
+    if (integrator != stepped_with) {
+        forces_current = false;
+        stepped_with = integrator;
+    }
+
+    switch (integrator) {
+        case Integrator::EULER:
+            calculate_forces();
+            add_external_forces();
+            integrate(delta_time);
+            forces_current = false;
+            break;
+        case Integrator::LEAPFROG:
+            kick_drift_kick(delta_time);
+            break;
+        case Integrator::BLOCK:
+            block_step(delta_time);
+            break;
+        case Integrator::HERMITE:
+            hermite_step(delta_time);
+            break;
+        case Integrator::RESPA:
+            respa_step(delta_time);
+            break;
+        case Integrator::YOSHIDA: {
+            // w1 = 1 / (2 - 2^(1/3)) and w0 = 1 - 2 w1, the middle step goes backwards in time
+            const float cube_root = std::cbrt(2.0f);
+            const float outer = 1.0f / (2.0f - cube_root);
+            const float inner = 1.0f - 2.0f * outer;
+            kick_drift_kick(outer * delta_time);
+            kick_drift_kick(inner * delta_time);
+            kick_drift_kick(outer * delta_time);
+            break;
+        }
+    }
+}
+
+void NBody::kick_drift_kick(float delta_time) {
+    if (!forces_current) {
+        calculate_forces();
+        add_external_forces();
+        update_encounters();
+    }
+    kick(0.5f * delta_time);
+    drift_encounters(delta_time);
+    calculate_forces();
+    add_external_forces();
+    update_encounters();
+    kick(0.5f * delta_time);
+    forces_current = true;
+}
+
+bool NBody::has_active_forces() const {
+    return false;
+}
+
+void NBody::calculate_active_forces(const std::vector<u_int>& active) {
+    static_cast<void>(active);
+    predict_positions();
+    calculate_forces();
+}
+
+void NBody::predict_positions() {
+    if (block_tick == 0) {
+        return;
+    }
+
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        if (body_ticks[i] == block_tick) {
+            continue;
+        }
+        const float elapsed = static_cast<float>(block_tick - body_ticks[i]) * tick_length;
+        for (u_int k = 0; k < dimension; ++k) {
+            bodies.position[k][i] += bodies.velocity[k][i] * elapsed;
+        }
+        body_ticks[i] = block_tick;
+    }
+}
+
+void NBody::calculate_far_forces(std::array<aligned_vector<float>, 3>& far) {
+    for (auto& component : far) {
+        component.assign(bodies.size(), 0.0f);
+    }
+    calculate_forces();
+}
+
+void NBody::calculate_near_forces() {
+    calculate_forces();
+}
+
+void NBody::find_close_pairs(float radius, std::vector<Encounter>& pairs) {
+    static_cast<void>(radius);
+    pairs.clear();
+}
+
+void NBody::update_encounters() {
+    encounters.clear();
+    if (encounter_radius > 0.0f) {
+        find_close_pairs(encounter_radius, encounters);
+    }
+
+    // Pairs flying past each other stay with the force pass
+    encounters.erase(std::remove_if(encounters.begin(), encounters.end(), [this](const Encounter& pair) {
+        const glm::vec3 separation = bodies.get_position(pair.second) - bodies.get_position(pair.first);
+        const glm::vec3 relative_velocity = bodies.get_velocity(pair.second) - bodies.get_velocity(pair.first);
+        const float total_mass = bodies.mass[pair.first] + bodies.mass[pair.second];
+        return 0.5f * glm::dot(relative_velocity, relative_velocity) >= gravity * total_mass / glm::length(separation);
+    }), encounters.end());
+
+    // The force pass applied the softened attraction within every pair
+    const float softening_squared = softening_factor * softening_factor;
+    for (const Encounter& pair : encounters) {
+        const glm::vec3 separation = bodies.get_position(pair.second) - bodies.get_position(pair.first);
+        const float inverse_distance = 1.0f / std::sqrt(glm::dot(separation, separation) + softening_squared);
+        const glm::vec3 attraction = gravity * separation * inverse_distance * inverse_distance * inverse_distance;
+        for (int k = 0; k < 3; ++k) {
+            bodies.acceleration[k][pair.first] -= bodies.mass[pair.second] * attraction[k];
+            bodies.acceleration[k][pair.second] += bodies.mass[pair.first] * attraction[k];
+        }
+    }
+}
+
+void NBody::drift_encounters(float delta_time) {
+    if (encounters.empty()) {
+        drift(delta_time);
+        return;
+    }
+
+    // The center of mass of a pair drifts, the separation follows the two body orbit. Solved in
+    // double precision, the separation is small against the positions.
+    encounter_states.resize(encounters.size());
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (std::ptrdiff_t e = 0; e < static_cast<std::ptrdiff_t>(encounters.size()); ++e) {
+        const u_int first = encounters[e].first;
+        const u_int second = encounters[e].second;
+        const double first_mass = bodies.mass[first];
+        const double second_mass = bodies.mass[second];
+        const double total_mass = first_mass + second_mass;
+
+        const glm::dvec3 first_position(bodies.get_position(first));
+        const glm::dvec3 first_velocity(bodies.get_velocity(first));
+        glm::dvec3 separation = glm::dvec3(bodies.get_position(second)) - first_position;
+        glm::dvec3 relative_velocity = glm::dvec3(bodies.get_velocity(second)) - first_velocity;
+
+        const glm::dvec3 center_velocity = first_velocity + second_mass / total_mass * relative_velocity;
+        const glm::dvec3 center = first_position + second_mass / total_mass * separation + center_velocity * static_cast<double>(delta_time);
+        Kepler::drift(static_cast<double>(gravity) * total_mass, delta_time, separation, relative_velocity);
+
+        encounter_states[e] = {
+            glm::vec3(center - second_mass / total_mass * separation),
+            glm::vec3(center + first_mass / total_mass * separation),
+            glm::vec3(center_velocity - second_mass / total_mass * relative_velocity),
+            glm::vec3(center_velocity + first_mass / total_mass * relative_velocity)
+        };
+    }
+
+    drift(delta_time);
+
+    for (size_t e = 0; e < encounters.size(); ++e) {
+        const std::array<glm::vec3, 4>& state = encounter_states[e];
+        for (int k = 0; k < 3; ++k) {
+            bodies.position[k][encounters[e].first] = state[0][k];
+            bodies.position[k][encounters[e].second] = state[1][k];
+            bodies.velocity[k][encounters[e].first] = state[2][k];
+            bodies.velocity[k][encounters[e].second] = state[3][k];
+        }
+    }
+}
+
+int NBody::choose_level(size_t index, float delta_time, float elapsed, int levels) const {
+    const glm::vec3 acceleration(bodies.acceleration[0][index], bodies.acceleration[1][index], bodies.acceleration[2][index]);
+    const float magnitude = glm::length(acceleration);
+
+    // Aarseth's |a| / |da/dt| with the derivative taken over the last step of the body. Before
+    // there is one, the time to cross the softening length from rest under the acceleration.
+    float step = delta_time;
+    if (elapsed > 0.0f) {
+        const glm::vec3 previous(previous_accelerations[0][index], previous_accelerations[1][index], previous_accelerations[2][index]);
+        const float derivative = glm::length(acceleration - previous) / elapsed;
+        if (derivative > 0.0f) {
+            step = timestep_accuracy * magnitude / derivative;
+        }
+    } else if (magnitude > 0.0f) {
+        step = std::sqrt(2.0f * timestep_accuracy * softening_factor / magnitude);
+    }
+
+    int level = 0;
+    for (float level_step = delta_time; level < levels && level_step > step; level_step *= 0.5f) {
+        ++level;
+    }
+    return level;
+}
+
+void NBody::block_step(float delta_time) {
+    const size_t count = bodies.size();
+    const auto body_count = static_cast<std::ptrdiff_t>(count);
+    const int levels = std::clamp(timestep_levels, 0, MAX_TIMESTEP_LEVEL);
+    const u_int ticks = 1u << levels;
+    const float tick = delta_time / static_cast<float>(ticks);
+
+    if (!forces_current || body_levels.size() != count) {
+        calculate_forces();
+        add_external_forces();
+        body_levels.resize(count);
+        for (auto& component : previous_accelerations) {
+            component.resize(count);
+        }
+
+        #pragma omp parallel for
+        for (std::ptrdiff_t i = 0; i < body_count; ++i) {
+            body_levels[i] = static_cast<uint8_t>(choose_level(i, delta_time, 0.0f, levels));
+            for (int k = 0; k < 3; ++k) {
+                previous_accelerations[k][i] = bodies.acceleration[k][i];
+            }
+        }
+    }
+
+    // The steps of every level end on the frame step, every body starts one with the frame
+    #pragma omp parallel for
+    for (std::ptrdiff_t i = 0; i < body_count; ++i) {
+        body_levels[i] = static_cast<uint8_t>(std::min(static_cast<int>(body_levels[i]), levels));
+        const float half_step = 0.5f * tick * static_cast<float>(ticks >> body_levels[i]);
+        for (u_int k = 0; k < dimension; ++k) {
+            bodies.velocity[k][i] += bodies.acceleration[k][i] * half_step;
+        }
+    }
+
+    level_bodies.resize(levels + 1);
+    for (auto& members : level_bodies) {
+        members.clear();
+    }
+    for (size_t i = 0; i < count; ++i) {
+        level_bodies[body_levels[i]].push_back(static_cast<u_int>(i));
+    }
+
+    // Only the bodies ending their step drift to the tick, get forces and their closing and
+    // opening kicks. The others move on a straight line until then, the force pass predicts
+    // their positions when it needs them.
+    body_ticks.assign(count, 0);
+    tick_length = tick;
+    for (u_int t = 1; t <= ticks; ++t) {
+        block_tick = t;
+
+        // The steps of a level end every ticks >> level ticks, on this one those of the levels
+        // from the coarsest whose step divides it
+        int coarsest = levels;
+        while (coarsest > 0 && t % (ticks >> (coarsest - 1)) == 0) {
+            --coarsest;
+        }
+        active.clear();
+        for (int level = coarsest; level <= levels; ++level) {
+            active.insert(active.end(), level_bodies[level].begin(), level_bodies[level].end());
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (std::ptrdiff_t a = 0; a < static_cast<std::ptrdiff_t>(active.size()); ++a) {
+            const u_int i = active[a];
+            const float elapsed = static_cast<float>(t - body_ticks[i]) * tick;
+            for (u_int k = 0; k < dimension; ++k) {
+                bodies.position[k][i] += bodies.velocity[k][i] * elapsed;
+            }
+            body_ticks[i] = t;
+        }
+
+        if (active.size() == count) {
+            calculate_forces();
+            add_external_forces();
+        } else {
+            calculate_active_forces(active);
+            add_external_forces(&active);
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (std::ptrdiff_t a = 0; a < static_cast<std::ptrdiff_t>(active.size()); ++a) {
+            const u_int i = active[a];
+            int level = body_levels[i];
+            const float step = tick * static_cast<float>(ticks >> level);
+            for (u_int k = 0; k < dimension; ++k) {
+                bodies.velocity[k][i] += bodies.acceleration[k][i] * 0.5f * step;
+            }
+
+            // Finer steps always line up with the tick, a coarser one only where its steps do,
+            // one level at a time
+            const int chosen = choose_level(i, delta_time, step, levels);
+            if (chosen > level) {
+                level = chosen;
+            } else if (chosen < level && t % (ticks >> (level - 1)) == 0) {
+                --level;
+            }
+            body_levels[i] = static_cast<uint8_t>(level);
+
+            for (int k = 0; k < 3; ++k) {
+                previous_accelerations[k][i] = bodies.acceleration[k][i];
+            }
+            if (t < ticks) {
+                const float half_step = 0.5f * tick * static_cast<float>(ticks >> level);
+                for (u_int k = 0; k < dimension; ++k) {
+                    bodies.velocity[k][i] += bodies.acceleration[k][i] * half_step;
+                }
+            }
+        }
+
+        // Only the active bodies changed levels, and never to one coarser than the tick
+        for (int level = coarsest; level <= levels; ++level) {
+            level_bodies[level].clear();
+        }
+        for (const u_int i : active) {
+            level_bodies[body_levels[i]].push_back(i);
+        }
+    }
+
+    // The last tick ends the steps of every level, all bodies are at the frame step again
+    block_tick = 0;
+    forces_current = true;
+}
+
+void NBody::hermite_step(float delta_time) {
+    if (!forces_current) {
+        calculate_hermite_forces();
+    }
+
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    const float dt = delta_time;
+    const float dt2 = dt * dt;
+
+    // Predict the positions and velocities from the Taylor series up to the jerk
+    for (u_int k = 0; k < dimension; ++k) {
+        start.position[k].assign(bodies.position[k].begin(), bodies.position[k].end());
+        start.velocity[k].assign(bodies.velocity[k].begin(), bodies.velocity[k].end());
+        start.acceleration[k].assign(bodies.acceleration[k].begin(), bodies.acceleration[k].end());
+        start.jerk[k].assign(bodies.jerk[k].begin(), bodies.jerk[k].end());
+
+        float* position = bodies.position[k].data();
+        float* velocity = bodies.velocity[k].data();
+        const float* acceleration = bodies.acceleration[k].data();
+        const float* jerk = bodies.jerk[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; i++) {
+            position[i] += dt * (velocity[i] + dt * (0.5f * acceleration[i] + dt * jerk[i] / 6.0f));
+            velocity[i] += dt * (acceleration[i] + 0.5f * dt * jerk[i]);
+        }
+    }
+
+    calculate_hermite_forces();
+
+    // Correct with the derivatives at both ends of the step
+    for (u_int k = 0; k < dimension; ++k) {
+        float* position = bodies.position[k].data();
+        float* velocity = bodies.velocity[k].data();
+        const float* acceleration = bodies.acceleration[k].data();
+        const float* jerk = bodies.jerk[k].data();
+        const float* position_0 = start.position[k].data();
+        const float* velocity_0 = start.velocity[k].data();
+        const float* acceleration_0 = start.acceleration[k].data();
+        const float* jerk_0 = start.jerk[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; i++) {
+            velocity[i] = velocity_0[i] + 0.5f * dt * (acceleration_0[i] + acceleration[i]) + dt2 * (jerk_0[i] - jerk[i]) / 12.0f;
+            position[i] = position_0[i] + 0.5f * dt * (velocity_0[i] + velocity[i]) + dt2 * (acceleration_0[i] - acceleration[i]) / 12.0f;
+        }
+    }
+
+    forces_current = true;
+}
+
+void NBody::respa_step(float delta_time) {
+    if (!forces_current) {
+        calculate_far_forces(far_accelerations);
+        add_external_far_forces();
+        far_step = 0;
+    }
+
+    // The far kicks open and close every interval, the near leapfrog runs in between. The
+    // interval is kept until it is over.
+    if (far_step == 0) {
+        far_steps = std::max(1, far_field_interval);
+        kick_far(0.5f * static_cast<float>(far_steps) * delta_time);
+    }
+    kick(0.5f * delta_time);
+    drift(delta_time);
+
+    if (++far_step == far_steps) {
+        calculate_far_forces(far_accelerations);
+        add_external_far_forces();
+        kick(0.5f * delta_time);
+        kick_far(0.5f * static_cast<float>(far_steps) * delta_time);
+        far_step = 0;
+    } else {
+        calculate_near_forces();
+        kick(0.5f * delta_time);
+    }
+    forces_current = true;
+}
+
+void NBody::add_external_forces(const std::vector<u_int>* active) {
+    if (!potential.empty()) {
+        potential.accelerate(bodies, gravity, bodies.acceleration, nullptr, active);
+    }
+}
+
+void NBody::add_external_far_forces() {
+    // The external field changes slowly, it kicks with the far field
+    if (!potential.empty()) {
+        potential.accelerate(bodies, gravity, far_accelerations);
+    }
+}
+
+void NBody::calculate_hermite_forces() {
+    // Solvers without a jerk leave the one of the last step, the field adds to zero instead
+    if (!potential.empty()) {
+        for (auto& component : bodies.jerk) {
+            std::fill(component.begin(), component.end(), 0.0f);
+        }
+    }
+    calculate_forces();
+    if (!potential.empty()) {
+        potential.accelerate(bodies, gravity, bodies.acceleration, &bodies.jerk);
+    }
+}
+
+void NBody::kick_far(float delta_time) {
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    for (u_int k = 0; k < dimension; ++k) {
+        float* velocity = bodies.velocity[k].data();
+        const float* acceleration = far_accelerations[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; i++) {
+            velocity[i] += acceleration[i] * delta_time;
+        }
+    }
+}
+
+void NBody::kick(float delta_time) {
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    for (u_int k = 0; k < dimension; ++k) {
+        float* velocity = bodies.velocity[k].data();
+        const float* acceleration = bodies.acceleration[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; i++) {
+            velocity[i] += acceleration[i] * delta_time;
+        }
+    }
+}
+
+void NBody::drift(float delta_time) {
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    for (u_int k = 0; k < dimension; ++k) {
+        float* position = bodies.position[k].data();
+        const float* velocity = bodies.velocity[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; i++) {
+            position[i] += velocity[i] * delta_time;
+        }
+    }
+}
+
+void NBody::integrate(float delta_time) {
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+
+    // Integrate accelerations to update positions and velocities, one component array at a time
+    for (u_int k = 0; k < dimension; ++k) {
+        float* position = bodies.position[k].data();
+        float* velocity = bodies.velocity[k].data();
+        const float* acceleration = bodies.acceleration[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; i++) {
+            position[i] += velocity[i] * delta_time + 0.5f * acceleration[i] * delta_time * delta_time;
+            velocity[i] = (velocity[i] + acceleration[i] * delta_time) * damping;
+        }
+    }
+}
+
+void NBody::render(glm::mat4 view, glm::mat4 view_projection) {
+    if (vao == 0) {
+        create_buffers();
+    }
+
+    const size_t count = bodies.size();
+    const auto component_size = static_cast<GLsizeiptr>(count * sizeof(float));
+
+    glBindVertexArray(vao);
+
+    // Upload the position components back to back and point one attribute at each of them
+    glBindBuffer(GL_ARRAY_BUFFER, position_vbo);
+    glBufferData(GL_ARRAY_BUFFER, 3 * component_size, nullptr, GL_STREAM_DRAW);
+    for (int k = 0; k < 3; ++k) {
+        glBufferSubData(GL_ARRAY_BUFFER, k * component_size, component_size, bodies.position[k].data());
+        glVertexAttribPointer(k, 1, GL_FLOAT, GL_FALSE, sizeof(float), reinterpret_cast<void*>(k * component_size));
+    }
+
+    // Colors only change when the bodies are regenerated
+    glBindBuffer(GL_ARRAY_BUFFER, color_vbo);
+    if (colors_dirty) {
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(count * sizeof(glm::vec3)), bodies.color.data(), GL_STATIC_DRAW);
+        colors_dirty = false;
+    }
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+
+    // Use the shader
+    shader->use();
+    shader->set_mat4("u_view_projection", view * view_projection);
+
+    // Draw the bodies
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+
+    // Unbind the vertex array and buffer
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void NBody::reset() {
+    randomize();
+}
+
+void NBody::randomize() {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<float> random_angle(0.0f, static_cast<float>(2.0 * M_PI));
+    std::uniform_real_distribution<float> random_color(0.0f, 1.0f);
+    std::uniform_real_distribution<float> random_radius(1.5f, 3.0f); // Adjust as per your simulation space
+    dimension = planar ? 2 : 3;
+
+    // Initialize the bodies using OpenMP, a planar run fills a ring in the xy plane
+    #pragma omp parallel for
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const float phi = random_angle(gen);
+        const float theta = dimension == 2 ? static_cast<float>(0.5 * M_PI) : random_angle(gen);
+        const float rad = random_radius(gen); // Adjust radius range as per your simulation space
+        bodies.position[0][i] = rad * std::cos(phi) * std::sin(theta);
+        bodies.position[1][i] = rad * std::sin(phi) * std::sin(theta);
+        bodies.position[2][i] = dimension == 2 ? 0.0f : rad * std::cos(theta);
+        for (int k = 0; k < 3; ++k) {
+            bodies.velocity[k][i] = 0.0f;
+            bodies.acceleration[k][i] = 0.0f;
+            bodies.jerk[k][i] = 0.0f;
+        }
+        bodies.color[i] = glm::vec3(random_color(gen), random_color(gen), random_color(gen));
+        bodies.mass[i] = i < bodies.size() - tracer_count ? mass : 0.0f;
+    }
+
+    colors_dirty = true;
+    forces_current = false;
+}
+
+void NBody::clear() {
+    bodies.clear();
+}
+
+size_t NBody::get_body_count() const {
+    return bodies.size();
+}
+
+void NBody::set_body_count(const size_t& body_count) {
+    clear();
+    bodies.resize(body_count);
+    tracer_count = std::min(tracer_count, body_count);
+    randomize();
+}
+
+size_t NBody::get_tracer_count() const {
+    return tracer_count;
+}
+
+void NBody::set_tracer_count(const size_t& tracer_count) {
+    this->tracer_count = std::min(tracer_count, bodies.size());
+
+    // Tracers keep their orbits, only the masses change
+    const size_t massive = bodies.size() - this->tracer_count;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        bodies.mass[i] = i < massive ? mass : 0.0f;
+    }
+    forces_current = false;
+}
+
+size_t NBody::get_source_count() const {
+    const size_t massive = bodies.size() - tracer_count;
+    return std::min(massive, static_cast<size_t>(static_cast<float>(massive) * interaction_percentage));
+}
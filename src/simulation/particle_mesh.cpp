@@ -0,0 +1,31 @@
+/*
+ * @path src/simulation/particle_mesh.cpp
+ * @file particle_mesh.cpp
+*/
+
+#include "simulation/particle_mesh.hpp"
+
+ParticleMesh::ParticleMesh(int bodies_count) {
+    // Resize the body store
+    set_body_count(bodies_count);
+}
+
+void ParticleMesh::calculate_forces() {
+    const size_t count = bodies.size();
+    const size_t interaction_count = get_source_count();
+
+    // The grid covers every body, only the first ones carry mass. The bound follows the bodies
+    // with some slack so the Green's function is not recomputed every step.
+    bound = bound.follow(Bound::enclosing(bodies, count), bound_hysteresis);
+    const auto assignment = triangular_shaped_cloud ? Mesh::Assignment::TRIANGULAR_SHAPED_CLOUD : Mesh::Assignment::CLOUD_IN_CELL;
+    mesh.assign(bodies, interaction_count, bound, mesh_size, assignment);
+    mesh.solve(gravity, softening_factor);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(count); ++i) {
+        const glm::vec3 acceleration = mesh.interpolate(bodies.get_position(i));
+        bodies.acceleration[0][i] = acceleration.x;
+        bodies.acceleration[1][i] = acceleration.y;
+        bodies.acceleration[2][i] = acceleration.z;
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * @path src/simulation/planetary.cpp
+ * @file planetary.cpp
+*/
+
+#include <cmath>
+#include <random>
+#include "simulation/planetary.hpp"
+#include "simulation/kepler.hpp"
+
+Planetary::Planetary(int bodies_count) : BarnesHut(0) {
+    // Debris and planets, light compared to the star
+    mass = 0.001f;
+    set_body_count(bodies_count);
+}
+
+void Planetary::update(const float& delta_time) {
+    if (!forces_current) {
+        calculate_forces();
+    }
+
+    kick(0.5f * delta_time);
+    drift_barycenter(0.5f * delta_time);
+    kepler_drift(delta_time);
+    drift_barycenter(0.5f * delta_time);
+    calculate_forces();
+    kick(0.5f * delta_time);
+    forces_current = true;
+}
+
+void Planetary::reset() {
+    BarnesHut::reset();
+    place_on_orbits();
+}
+
+void Planetary::set_body_count(const size_t& body_count) {
+    BarnesHut::set_body_count(body_count);
+    place_on_orbits();
+}
+
+void Planetary::place_on_orbits() {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<float> random_angle(0.0f, static_cast<float>(2.0 * M_PI));
+    // Uniform in area between half the radius and the radius
+    std::uniform_real_distribution<float> random_area(0.25f, 1.0f);
+    std::normal_distribution<float> random_height(0.0f, 0.01f * radius);
+
+    const size_t count = bodies.size();
+    const float mu = gravity * star_mass;
+    glm::dvec3 momentum(0.0);
+    double total_mass = star_mass;
+
+    for (size_t i = 0; i < count; ++i) {
+        const float distance = radius * std::sqrt(random_area(gen));
+        const float angle = random_angle(gen);
+        const float speed = std::sqrt(mu / distance);
+
+        bodies.position[0][i] = distance * std::cos(angle);
+        bodies.position[1][i] = distance * std::sin(angle);
+        bodies.position[2][i] = dimension == 2 ? 0.0f : random_height(gen);
+        bodies.velocity[0][i] = -speed * std::sin(angle);
+        bodies.velocity[1][i] = speed * std::cos(angle);
+        bodies.velocity[2][i] = 0.0f;
+
+        momentum += static_cast<double>(bodies.mass[i]) * glm::dvec3(bodies.get_velocity(i));
+        total_mass += bodies.mass[i];
+    }
+
+    // Heliocentric to barycentric velocities, the star moves against the bodies
+    const glm::vec3 star_velocity = glm::vec3(-momentum / total_mass);
+    for (size_t i = 0; i < count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            bodies.velocity[k][i] += star_velocity[k];
+        }
+    }
+
+    forces_current = false;
+}
+
+void Planetary::kepler_drift(float delta_time) {
+    const double mu = static_cast<double>(gravity) * star_mass;
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+
+    // Every body follows its own orbit, they are independent of each other
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        glm::dvec3 position(bodies.get_position(i));
+        glm::dvec3 velocity(bodies.get_velocity(i));
+        Kepler::drift(mu, delta_time, position, velocity);
+        for (int k = 0; k < 3; ++k) {
+            bodies.position[k][i] = static_cast<float>(position[k]);
+            bodies.velocity[k][i] = static_cast<float>(velocity[k]);
+        }
+    }
+}
+
+void Planetary::drift_barycenter(float delta_time) {
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    double px = 0.0, py = 0.0, pz = 0.0;
+
+    #pragma omp parallel for reduction(+ : px, py, pz)
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        px += static_cast<double>(bodies.mass[i]) * bodies.velocity[0][i];
+        py += static_cast<double>(bodies.mass[i]) * bodies.velocity[1][i];
+        pz += static_cast<double>(bodies.mass[i]) * bodies.velocity[2][i];
+    }
+
+    const glm::vec3 shift = glm::vec3(glm::dvec3(px, py, pz) / static_cast<double>(star_mass)) * delta_time;
+    for (u_int k = 0; k < dimension; ++k) {
+        float* position = bodies.position[k].data();
+
+        #pragma omp parallel for simd
+        for (std::ptrdiff_t i = 0; i < count; ++i) {
+            position[i] += shift[k];
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * @path src/simulation/potential.cpp
+ * @file potential.cpp
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "simulation/potential.hpp"
+
+// Adds field(dx, dy, dz, gx, gy, gz), the acceleration at the offset from the center, at every
+// target in one SIMD loop. The jerk is the central difference of the field one step before and
+// after the body along its velocity.
+template <typename Field>
+static void accumulate(const BodyStore& bodies, const glm::vec3& center, float jerk_step, std::array<aligned_vector<float>, 3>& acceleration,
+                       std::array<aligned_vector<float>, 3>* jerk, const std::vector<u_int>* active, Field field) {
+    const float* x = bodies.position[0].data();
+    const float* y = bodies.position[1].data();
+    const float* z = bodies.position[2].data();
+    float* ax = acceleration[0].data();
+    float* ay = acceleration[1].data();
+    float* az = acceleration[2].data();
+    const u_int* indices = active != nullptr ? active->data() : nullptr;
+    const auto targets = static_cast<std::ptrdiff_t>(active != nullptr ? active->size() : bodies.size());
+
+    #pragma omp parallel for simd
+    for (std::ptrdiff_t t = 0; t < targets; ++t) {
+        const std::ptrdiff_t i = indices != nullptr ? static_cast<std::ptrdiff_t>(indices[t]) : t;
+        float gx, gy, gz;
+        field(x[i] - center.x, y[i] - center.y, z[i] - center.z, gx, gy, gz);
+        ax[i] += gx;
+        ay[i] += gy;
+        az[i] += gz;
+    }
+
+    if (jerk == nullptr) {
+        return;
+    }
+
+    const float* vx = bodies.velocity[0].data();
+    const float* vy = bodies.velocity[1].data();
+    const float* vz = bodies.velocity[2].data();
+    float* jx = (*jerk)[0].data();
+    float* jy = (*jerk)[1].data();
+    float* jz = (*jerk)[2].data();
+
+    #pragma omp parallel for simd
+    for (std::ptrdiff_t t = 0; t < targets; ++t) {
+        const std::ptrdiff_t i = indices != nullptr ? static_cast<std::ptrdiff_t>(indices[t]) : t;
+        const float speed = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+        const float step = jerk_step / std::max(speed, FLT_MIN);
+        const float dx = x[i] - center.x, dy = y[i] - center.y, dz = z[i] - center.z;
+
+        float ahead_x, ahead_y, ahead_z, behind_x, behind_y, behind_z;
+        field(dx + step * vx[i], dy + step * vy[i], dz + step * vz[i], ahead_x, ahead_y, ahead_z);
+        field(dx - step * vx[i], dy - step * vy[i], dz - step * vz[i], behind_x, behind_y, behind_z);
+        const float scale = 0.5f / step;
+        jx[i] += (ahead_x - behind_x) * scale;
+        jy[i] += (ahead_y - behind_y) * scale;
+        jz[i] += (ahead_z - behind_z) * scale;
+    }
+}
+
+bool Potential::empty() const {
+    return components.empty();
+}
+
+void Potential::accelerate(const BodyStore& bodies, float gravity, std::array<aligned_vector<float>, 3>& acceleration, std::array<aligned_vector<float>, 3>* jerk, const std::vector<u_int>* active) const {
+    for (const Component& component : components) {
+        const float gm = gravity * component.mass;
+        const float a = component.scale;
+        const float jerk_step = JERK_STEP * (a > 0.0f ? a : 1.0f);
+
+        switch (component.profile) {
+            case Profile::POINT_MASS: {
+                const float a_squared = a * a;
+                accumulate(bodies, component.center, jerk_step, acceleration, jerk, active, [gm, a_squared](float dx, float dy, float dz, float& gx, float& gy, float& gz) {
+                    const float distance_squared = dx * dx + dy * dy + dz * dz + a_squared;
+                    const float inv_distance = distance_squared > 0.0f ? 1.0f / std::sqrt(distance_squared) : 0.0f;
+                    const float factor = -gm * inv_distance * inv_distance * inv_distance;
+                    gx = factor * dx;
+                    gy = factor * dy;
+                    gz = factor * dz;
+                });
+                break;
+            }
+            case Profile::HERNQUIST:
+                accumulate(bodies, component.center, jerk_step, acceleration, jerk, active, [gm, a](float dx, float dy, float dz, float& gx, float& gy, float& gz) {
+                    const float r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                    const float factor = r > 0.0f ? -gm / (r * (r + a) * (r + a)) : 0.0f;
+                    gx = factor * dx;
+                    gy = factor * dy;
+                    gz = factor * dz;
+                });
+                break;
+            case Profile::NFW: {
+                const float inv_scale = 1.0f / std::max(a, MIN_SCALE);
+                accumulate(bodies, component.center, jerk_step, acceleration, jerk, active, [gm, inv_scale](float dx, float dy, float dz, float& gx, float& gy, float& gz) {
+                    const float r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                    const float x = r * inv_scale;
+                    // Enclosed mass over M, ln(1 + x) - x / (1 + x) cancels near the center
+                    const float enclosed = x < 0.01f ? x * x * (0.5f - x * (2.0f / 3.0f - 0.75f * x)) : std::log1p(x) - x / (1.0f + x);
+                    const float factor = r > 0.0f ? -gm * enclosed / (r * r * r) : 0.0f;
+                    gx = factor * dx;
+                    gy = factor * dy;
+                    gz = factor * dz;
+                });
+                break;
+            }
+            case Profile::MIYAMOTO_NAGAI: {
+                const float b_squared = component.shape * component.shape;
+                accumulate(bodies, component.center, jerk_step, acceleration, jerk, active, [gm, a, b_squared](float dx, float dy, float dz, float& gx, float& gy, float& gz) {
+                    const float zeta = std::sqrt(dz * dz + b_squared);
+                    const float s = a + zeta;
+                    const float d_squared = dx * dx + dy * dy + s * s;
+                    const float inv_d = 1.0f / std::sqrt(d_squared);
+                    const float factor = -gm * inv_d * inv_d * inv_d;
+                    gx = factor * dx;
+                    gy = factor * dy;
+                    gz = zeta > 0.0f ? factor * dz * s / zeta : 0.0f;
+                });
+                break;
+            }
+            case Profile::LOGARITHMIC: {
+                const float v_squared = component.velocity * component.velocity;
+                const float core_squared = a * a;
+                const float q = std::max(component.shape, MIN_SCALE);
+                const float inv_q_squared = 1.0f / (q * q);
+                accumulate(bodies, component.center, jerk_step, acceleration, jerk, active, [v_squared, core_squared, inv_q_squared](float dx, float dy, float dz, float& gx, float& gy, float& gz) {
+                    const float denominator = core_squared + dx * dx + dy * dy + dz * dz * inv_q_squared;
+                    const float factor = denominator > 0.0f ? -v_squared / denominator : 0.0f;
+                    gx = factor * dx;
+                    gy = factor * dy;
+                    gz = factor * dz * inv_q_squared;
+                });
+                break;
+            }
+        }
+    }
+}
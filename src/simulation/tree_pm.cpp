@@ -0,0 +1,115 @@
+/*
+ * @path src/simulation/tree_pm.cpp
+ * @file tree_pm.cpp
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "simulation/tree_pm.hpp"
+
+TreePM::TreePM(int bodies_count) : BarnesHut(bodies_count) {}
+
+void TreePM::calculate_forces() {
+    calculate_split_forces(nullptr);
+}
+
+void TreePM::calculate_active_forces(const std::vector<u_int>& active) {
+    calculate_split_forces(&active);
+}
+
+void TreePM::calculate_far_forces(std::array<aligned_vector<float>, 3>& far) {
+    solve_mesh();
+    calculate_tree_forces(split, nullptr, &mesh_bound);
+
+    const auto count = static_cast<std::ptrdiff_t>(bodies.size());
+    for (auto& component : far) {
+        component.resize(bodies.size());
+    }
+
+    // The long range forces are the far field, the short range walk is repeated every step. The
+    // walk of the bodies outside the mesh is the whole force.
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t i = 0; i < count; ++i) {
+        const glm::vec3 position = bodies.get_position(i);
+        const glm::vec3 acceleration = mesh_bound.contains(position) ? mesh.interpolate(position) : glm::vec3(0.0f);
+        for (int k = 0; k < 3; ++k) {
+            far[k][i] = acceleration[k];
+        }
+    }
+}
+
+void TreePM::calculate_near_forces() {
+    calculate_tree_forces(split, nullptr, &mesh_bound);
+}
+
+Bound TreePM::fit_bulk(size_t count) {
+    if (count == 0) {
+        return Bound::enclosing(bodies, count);
+    }
+
+    const float* x = bodies.position[0].data();
+    const float* y = bodies.position[1].data();
+    const float* z = bodies.position[2].data();
+    const float* mass = bodies.mass.data();
+    float mx = 0.0f, my = 0.0f, mz = 0.0f, total_mass = 0.0f;
+
+    #pragma omp parallel for simd reduction(+:mx, my, mz, total_mass)
+    for (size_t i = 0; i < count; ++i) {
+        mx += mass[i] * x[i];
+        my += mass[i] * y[i];
+        mz += mass[i] * z[i];
+        total_mass += mass[i];
+    }
+    const glm::vec3 center = total_mass > 0.0f ? glm::vec3(mx, my, mz) / total_mass : glm::vec3(0.0f);
+
+    // Distance of every body from the center along its farthest axis, the cube reaching the
+    // quantile holds that share of the bodies
+    extents.resize(count);
+    #pragma omp parallel for simd
+    for (size_t i = 0; i < count; ++i) {
+        extents[i] = std::max(std::abs(x[i] - center.x), std::max(std::abs(y[i] - center.y), std::abs(z[i] - center.z)));
+    }
+    const auto bulk = static_cast<std::ptrdiff_t>(MESH_FRACTION * static_cast<float>(count - 1));
+    std::nth_element(extents.begin(), extents.begin() + bulk, extents.end());
+
+    // Without distant outliers the mesh still covers every body
+    const float farthest = *std::max_element(extents.begin() + bulk, extents.end());
+    const float half_width = farthest <= OUTLIER_REACH * extents[bulk] ? farthest : extents[bulk];
+    return {center, std::max(half_width, 1e-3f)};
+}
+
+void TreePM::solve_mesh() {
+    const size_t interaction_count = get_source_count();
+
+    // The mesh covers the bulk of the sources, so that a few distant bodies do not coarsen its
+    // cells and with them the split. The bodies outside it are left out and the tree walk sums
+    // their pairs with the full kernel. The split follows the cell size, so the mesh is set up
+    // before the tree is walked.
+    mesh_bound = mesh_bound.follow(fit_bulk(interaction_count), bound_hysteresis);
+    const auto assignment = triangular_shaped_cloud ? Mesh::Assignment::TRIANGULAR_SHAPED_CLOUD : Mesh::Assignment::CLOUD_IN_CELL;
+    mesh.assign(bodies, interaction_count, mesh_bound, mesh_size, assignment, true);
+    split = SPLIT_CELLS * mesh.get_cell_size();
+    mesh.solve(gravity, softening_factor, split);
+}
+
+void TreePM::calculate_split_forces(const std::vector<u_int>* active) {
+    const size_t count = bodies.size();
+    if (active == nullptr || split == 0.0f) {
+        solve_mesh();
+    }
+    calculate_tree_forces(split, active, &mesh_bound);
+
+    const auto targets = static_cast<std::ptrdiff_t>(active != nullptr ? active->size() : count);
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t target = 0; target < targets; ++target) {
+        const std::ptrdiff_t i = active != nullptr ? static_cast<std::ptrdiff_t>((*active)[target]) : target;
+        const glm::vec3 position = bodies.get_position(i);
+        if (!mesh_bound.contains(position)) {
+            continue;
+        }
+        const glm::vec3 acceleration = mesh.interpolate(position);
+        bodies.acceleration[0][i] += acceleration.x;
+        bodies.acceleration[1][i] += acceleration.y;
+        bodies.acceleration[2][i] += acceleration.z;
+    }
+}
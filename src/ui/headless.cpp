@@ -0,0 +1,257 @@
+/*
+ * @path src/ui/headless.cpp
+ * @file headless.cpp
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "ui/headless.hpp"
+#include "simulation/kernel.hpp"
+
+// Unknown values would run another setup than the one asked for without a word
+[[noreturn]] static void reject(std::string_view option, const std::string& value) {
+    std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Malformed numbers, trailing characters and values out of the range are rejected as well
+static int parse_int(std::string_view option, const std::string& value, int minimum = std::numeric_limits<int>::min(), int maximum = std::numeric_limits<int>::max()) {
+    size_t end = 0;
+    try {
+        const int result = std::stoi(value, &end);
+        if (end == value.size() && result >= minimum && result <= maximum) {
+            return result;
+        }
+    } catch (const std::logic_error&) {
+    }
+    reject(option, value);
+}
+
+static float parse_float(std::string_view option, const std::string& value, float minimum = std::numeric_limits<float>::lowest(), float maximum = std::numeric_limits<float>::max()) {
+    size_t end = 0;
+    try {
+        const float result = std::stof(value, &end);
+        if (end == value.size() && result >= minimum && result <= maximum) {
+            return result;
+        }
+    } catch (const std::logic_error&) {
+    }
+    reject(option, value);
+}
+
+Headless::Headless(const Settings& settings) : settings(settings) {}
+
+void Headless::start() const {
+    std::cout << "Bodies: " << settings.body_count << std::endl;
+    std::cout << "Tracers: " << settings.tracer_count << std::endl;
+    std::cout << "Steps: " << settings.steps << std::endl;
+    std::cout << "Force kernel: " << Kernel::get_isa_name() << std::endl;
+
+    for (const int leaf_capacity : settings.leaf_capacities) {
+        const std::unique_ptr<NBody> n_body(Scene::create(settings.solver, settings.body_count));
+        if (settings.integrator == NBody::Integrator::BLOCK && !n_body->has_active_forces()) {
+            std::cerr << "Block steps need a solver with forces of the active bodies alone (bh, treepm or direct)" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        n_body->planar = settings.planar;
+        n_body->set_tracer_count(settings.tracer_count);
+        n_body->theta = settings.theta;
+        n_body->integrator = settings.integrator;
+        n_body->timestep_levels = settings.timestep_levels;
+        n_body->timestep_accuracy = settings.timestep_accuracy;
+        n_body->far_field_interval = settings.far_field_interval;
+        n_body->near_field_scale = settings.near_field_scale;
+        n_body->encounter_radius = settings.encounter_radius;
+        n_body->multipole_degree = settings.multipole_degree;
+        n_body->opening = settings.opening;
+        n_body->force_accuracy = settings.force_accuracy;
+        n_body->leaf_capacity = leaf_capacity;
+        n_body->refit_interval = settings.refit_interval;
+        n_body->group_walk = settings.group_walk;
+        n_body->expansion_order = settings.expansion_order;
+        n_body->fmm_leaf_capacity = settings.fmm_leaf_capacity;
+        n_body->symmetric_pairs = settings.symmetric_pairs;
+        n_body->mesh_size = settings.mesh_size;
+        n_body->triangular_shaped_cloud = settings.triangular_shaped_cloud;
+        n_body->star_mass = settings.star_mass;
+        n_body->potential.components = settings.potential;
+        // The bodies are placed for the settings, e.g. on the orbits about a star of star_mass
+        n_body->reset();
+
+        const auto start_time = std::chrono::high_resolution_clock::now();
+        for (int step = 0; step < settings.steps; ++step) {
+            n_body->update(settings.delta_time);
+        }
+        const auto end_time = std::chrono::high_resolution_clock::now();
+
+        const double milliseconds = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+        std::cout << "Leaf capacity " << leaf_capacity << ": " << milliseconds / settings.steps << " ms/step" << std::endl;
+    }
+}
+
+bool Headless::requested(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (FLAG == argv[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Headless::Settings Headless::parse(int argc, char** argv) {
+    Settings settings;
+
+    // Every option but the flag itself takes a value, a positive number unless said otherwise
+    const float positive = std::numeric_limits<float>::min();
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == FLAG) {
+            continue;
+        }
+        if (i + 1 == argc) {
+            reject(option, "nothing");
+        }
+        const std::string value = argv[i + 1];
+
+        if (option == "--solver") {
+            if (value == "fmm") {
+                settings.solver = Scene::Solver::FMM;
+            } else if (value == "direct") {
+                settings.solver = Scene::Solver::DIRECT_SUM;
+            } else if (value == "pm") {
+                settings.solver = Scene::Solver::PARTICLE_MESH;
+            } else if (value == "treepm") {
+                settings.solver = Scene::Solver::TREE_PM;
+            } else if (value == "planetary") {
+                settings.solver = Scene::Solver::PLANETARY;
+            } else if (value == "bh") {
+                settings.solver = Scene::Solver::BARNES_HUT;
+            } else {
+                reject(option, value);
+            }
+        } else if (option == "--integrator") {
+            if (value == "leapfrog") {
+                settings.integrator = NBody::Integrator::LEAPFROG;
+            } else if (value == "yoshida") {
+                settings.integrator = NBody::Integrator::YOSHIDA;
+            } else if (value == "block") {
+                settings.integrator = NBody::Integrator::BLOCK;
+            } else if (value == "hermite") {
+                settings.integrator = NBody::Integrator::HERMITE;
+            } else if (value == "respa") {
+                settings.integrator = NBody::Integrator::RESPA;
+            } else if (value == "euler") {
+                settings.integrator = NBody::Integrator::EULER;
+            } else {
+                reject(option, value);
+            }
+        } else if (option == "--levels") {
+            settings.timestep_levels = parse_int(option, value, 0, NBody::MAX_TIMESTEP_LEVEL);
+        } else if (option == "--eta") {
+            settings.timestep_accuracy = parse_float(option, value, positive);
+        } else if (option == "--far-interval") {
+            settings.far_field_interval = parse_int(option, value, 1);
+        } else if (option == "--near-scale") {
+            settings.near_field_scale = parse_float(option, value, positive);
+        } else if (option == "--encounters") {
+            settings.encounter_radius = parse_float(option, value, 0.0f);
+        } else if (option == "--bodies") {
+            settings.body_count = parse_int(option, value, 1);
+        } else if (option == "--planar") {
+            settings.planar = value != "0";
+        } else if (option == "--tracers") {
+            settings.tracer_count = parse_int(option, value, 0);
+        } else if (option == "--steps") {
+            settings.steps = parse_int(option, value, 1);
+        } else if (option == "--dt") {
+            settings.delta_time = parse_float(option, value, positive);
+        } else if (option == "--theta") {
+            settings.theta = parse_float(option, value, 0.0f);
+        } else if (option == "--opening") {
+            if (value == "bmax") {
+                settings.opening = Tree::Opening::BMAX;
+            } else if (value == "box") {
+                settings.opening = Tree::Opening::BOX;
+            } else if (value == "relative") {
+                settings.opening = Tree::Opening::RELATIVE;
+            } else if (value == "geometric") {
+                settings.opening = Tree::Opening::GEOMETRIC;
+            } else {
+                reject(option, value);
+            }
+        } else if (option == "--accuracy") {
+            settings.force_accuracy = parse_float(option, value, positive);
+        } else if (option == "--multipoles") {
+            settings.multipole_degree = parse_int(option, value, 0, 3);
+        } else if (option == "--order") {
+            settings.expansion_order = parse_int(option, value, 1, FMM::MAX_ORDER);
+        } else if (option == "--fmm-leaf-capacity") {
+            settings.fmm_leaf_capacity = parse_int(option, value, 1);
+        } else if (option == "--symmetric") {
+            settings.symmetric_pairs = value != "0";
+        } else if (option == "--mesh") {
+            settings.mesh_size = parse_int(option, value, Mesh::MIN_SIZE, Mesh::MAX_SIZE);
+        } else if (option == "--tsc") {
+            settings.triangular_shaped_cloud = value != "0";
+        } else if (option == "--star-mass") {
+            settings.star_mass = parse_float(option, value, positive);
+        } else if (option == "--potential") {
+            // profile,mass,scale[,shape[,velocity]], once per component
+            Potential::Component component;
+            std::stringstream stream(value);
+            std::string item;
+            std::getline(stream, item, ',');
+            if (item == "point") {
+                component.profile = Potential::Profile::POINT_MASS;
+            } else if (item == "nfw") {
+                component.profile = Potential::Profile::NFW;
+            } else if (item == "mn") {
+                component.profile = Potential::Profile::MIYAMOTO_NAGAI;
+            } else if (item == "log") {
+                component.profile = Potential::Profile::LOGARITHMIC;
+            } else if (item == "hernquist") {
+                component.profile = Potential::Profile::HERNQUIST;
+            } else {
+                reject(option, value);
+            }
+            // The NFW scale radius and the shape divide the profiles, a scale of 0 is fine for the others
+            const float scale_minimum = component.profile == Potential::Profile::NFW ? Potential::MIN_SCALE : 0.0f;
+            float* parameters[] = {&component.mass, &component.scale, &component.shape, &component.velocity};
+            const float minimums[] = {std::numeric_limits<float>::lowest(), scale_minimum, Potential::MIN_SCALE, 0.0f};
+            for (size_t p = 0; p < std::size(parameters); ++p) {
+                if (!std::getline(stream, item, ',')) {
+                    break;
+                }
+                *parameters[p] = parse_float(option, item, minimums[p]);
+            }
+            settings.potential.push_back(component);
+        } else if (option == "--group-walk") {
+            settings.group_walk = value != "0";
+        } else if (option == "--refit-interval") {
+            settings.refit_interval = parse_int(option, value, 1);
+        } else if (option == "--leaf-capacity") {
+            // Comma separated list, every capacity is benchmarked in turn
+            settings.leaf_capacities.clear();
+            std::stringstream stream(value);
+            std::string item;
+            while (std::getline(stream, item, ',')) {
+                settings.leaf_capacities.push_back(parse_int(option, item, 1));
+            }
+            if (settings.leaf_capacities.empty()) {
+                reject(option, value);
+            }
+        } else {
+            reject("option", std::string(option));
+        }
+        ++i;
+    }
+
+    return settings;
+}
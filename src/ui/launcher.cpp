@@ -3,6 +3,7 @@
  * @file launcher.cpp
 */
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -17,6 +18,7 @@
 #include "ui/launcher.hpp"
 #include "graphics/manager.hpp"
 #include "scene/scene.hpp"
+#include "simulation/kernel.hpp"
 
 #define GL_SILENCE_DEPRECATION
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -144,6 +146,7 @@ Launcher::Launcher() {
     std::cout << "GLFW Version: " << get_glfw_version() << std::endl;
     std::cout << "GLAD Version: " << get_glad_version() << std::endl;
     std::cout << "ImGui Version: " << get_imgui_version() << std::endl;
+    std::cout << "Force kernel: " << Kernel::get_isa_name() << std::endl;
 
 }
 
@@ -259,6 +262,7 @@ void Launcher::handle_ui(float delta_time) {
             ImGui::Text("Window width: %d", display_width);
             ImGui::Text("Window height: %d", display_height);
             ImGui::Text("OpenGl Version: %s", get_gl_version().data());
+            ImGui::Text("Force kernel: %s", Kernel::get_isa_name().data());
             ImGui::End();
         }
        {
@@ -313,6 +317,13 @@ void Launcher::handle_ui(float delta_time) {
        }
        {
             ImGui::Begin("Simulator settings");
+            ImGui::Text("Solver: ");
+            static int solver = static_cast<int>(scene->solver);
+            const char* solvers[] = {"Barnes-Hut", "Fast multipole", "Direct summation", "Particle mesh", "TreePM", "Planetary"};
+            if (ImGui::Combo("##solver", &solver, solvers, IM_ARRAYSIZE(solvers))) {
+                scene->solver = static_cast<Scene::Solver>(solver);
+            }
+
             ImGui::Text("Start Simulation");
             ImGui::Button("Start##start_btn");
             if (ImGui::IsItemClicked()) {
@@ -328,7 +339,19 @@ void Launcher::handle_ui(float delta_time) {
             if (ImGui::IsItemClicked()) {
                 scene->n_body->set_body_count(body_count);
             }
+
+            ImGui::Text("Tracer count: ");
+            static int tracer_count = static_cast<int>(scene->n_body->get_tracer_count());
+            ImGui::DragInt("##tracer_count", &tracer_count, 1, 0, MAX_BODY_COUNT);
+            ImGui::Button("Validate##tracer_count_setter");
+            if (ImGui::IsItemClicked()) {
+                scene->n_body->set_tracer_count(tracer_count);
+            }
             
+            if (ImGui::Checkbox("Planar", &scene->n_body->planar)) {
+                reset();
+            }
+
             ImGui::NewLine();
 
             ImGui::Text("Reset Simulation");
@@ -381,6 +404,32 @@ void Launcher::handle_ui(float delta_time) {
 
             ImGui::NewLine();
 
+            ImGui::Text("Integrator:");
+            const char* integrators[] = {"Euler", "Leapfrog", "Yoshida", "Block steps", "Hermite", "RESPA"};
+            int integrator = static_cast<int>(scene->n_body->integrator);
+            if (ImGui::Combo("##integrator", &integrator, integrators, IM_ARRAYSIZE(integrators))) {
+                // Block steps would redo the whole pass of the other solvers on every tick
+                const auto chosen = static_cast<NBody::Integrator>(integrator);
+                if (chosen != NBody::Integrator::BLOCK || scene->n_body->has_active_forces()) {
+                    scene->n_body->integrator = chosen;
+                }
+            }
+
+            ImGui::Text("Block step levels:");
+            ImGui::DragInt("##timestep_levels", &scene->n_body->timestep_levels, 1, 0, NBody::MAX_TIMESTEP_LEVEL);
+
+            ImGui::Text("Block step accuracy:");
+            ImGui::DragFloat("##timestep_accuracy", &scene->n_body->timestep_accuracy, 0.001f, 0.001f, 1.0f, "%.3f");
+
+            ImGui::Text("Far field interval:");
+            ImGui::DragInt("##far_field_interval", &scene->n_body->far_field_interval, 1, 1, 64);
+
+            ImGui::Text("Near field scale:");
+            ImGui::DragFloat("##near_field_scale", &scene->n_body->near_field_scale, 0.001f, 0.001f, 1.0f, "%.3f");
+
+            ImGui::Text("Encounter radius:");
+            ImGui::DragFloat("##encounter_radius", &scene->n_body->encounter_radius, 0.001f, 0.0f, 1.0f, "%.3f");
+
             ImGui::Text("Damping:");
             ImGui::DragFloat("##damping", &scene->n_body->damping, 0.0f, 0.0f, 0.1f);
 
@@ -390,6 +439,84 @@ void Launcher::handle_ui(float delta_time) {
             ImGui::Text("Theta:");
             ImGui::DragFloat("##theta", &scene->n_body->theta, 0.0f, 0.0f, 1.0f);
 
+            ImGui::Text("Opening criterion:");
+            const char* openings[] = {"Geometric", "Salmon-Warren bmax", "Box distance", "Relative"};
+            int opening = static_cast<int>(scene->n_body->opening);
+            if (ImGui::Combo("##opening", &opening, openings, IM_ARRAYSIZE(openings))) {
+                scene->n_body->opening = static_cast<Tree::Opening>(opening);
+            }
+
+            ImGui::Text("Force accuracy:");
+            ImGui::DragFloat("##force_accuracy", &scene->n_body->force_accuracy, 0.0001f, 0.0001f, 0.1f, "%.4f");
+
+            ImGui::Text("Cell moments:");
+            const char* moments[] = {"Monopole", "Quadrupole", "Octupole"};
+            int moment = std::clamp(scene->n_body->multipole_degree - 1, 0, 2);
+            if (ImGui::Combo("##cell_moments", &moment, moments, IM_ARRAYSIZE(moments))) {
+                scene->n_body->multipole_degree = moment == 0 ? 0 : moment + 1;
+            }
+
+            ImGui::Text("Expansion order:");
+            ImGui::DragInt("##expansion_order", &scene->n_body->expansion_order, 1, 1, FMM::MAX_ORDER);
+
+            ImGui::Text("FMM leaf capacity:");
+            ImGui::DragInt("##fmm_leaf_capacity", &scene->n_body->fmm_leaf_capacity, 1, 1, 256);
+
+            ImGui::Checkbox("Symmetric pairs", &scene->n_body->symmetric_pairs);
+
+            ImGui::Text("Mesh size:");
+            ImGui::DragInt("##mesh_size", &scene->n_body->mesh_size, 1, Mesh::MIN_SIZE, 256);
+
+            ImGui::Checkbox("Triangular shaped cloud", &scene->n_body->triangular_shaped_cloud);
+
+            ImGui::Text("Star mass:");
+            // The orbits are placed for the star, they are placed again for another one
+            if (ImGui::DragFloat("##star_mass", &scene->n_body->star_mass, 1.0f, 1.0f, 100000.0f)) {
+                scene->n_body->reset();
+            }
+
+            ImGui::Text("External potential:");
+            std::vector<Potential::Component>& components = scene->n_body->potential.components;
+            const char* profiles[] = {"Point mass", "Hernquist", "NFW", "Miyamoto-Nagai", "Logarithmic"};
+            for (size_t c = 0; c < components.size(); ++c) {
+                Potential::Component& component = components[c];
+                ImGui::PushID(static_cast<int>(c));
+                int profile = static_cast<int>(component.profile);
+                if (ImGui::Combo("##profile", &profile, profiles, IM_ARRAYSIZE(profiles))) {
+                    component.profile = static_cast<Potential::Profile>(profile);
+                }
+                ImGui::DragFloat("Mass", &component.mass, 1.0f, 0.0f, 100000.0f);
+                const float scale_minimum = component.profile == Potential::Profile::NFW ? Potential::MIN_SCALE : 0.0f;
+                ImGui::DragFloat("Scale", &component.scale, 0.01f, scale_minimum, 100.0f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+                if (component.profile == Potential::Profile::MIYAMOTO_NAGAI || component.profile == Potential::Profile::LOGARITHMIC) {
+                    ImGui::DragFloat("Shape", &component.shape, 0.01f, Potential::MIN_SCALE, 10.0f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+                }
+                if (component.profile == Potential::Profile::LOGARITHMIC) {
+                    ImGui::DragFloat("Velocity", &component.velocity, 0.01f, 0.0f, 100.0f);
+                }
+                ImGui::DragFloat3("Center", &component.center[0], 0.01f);
+                const bool removed = ImGui::Button("Remove");
+                ImGui::PopID();
+                if (removed) {
+                    components.erase(components.begin() + static_cast<std::ptrdiff_t>(c));
+                    break;
+                }
+            }
+            if (ImGui::Button("Add component")) {
+                components.emplace_back();
+            }
+
+            ImGui::Text("Leaf capacity:");
+            ImGui::DragInt("##leaf_capacity", &scene->n_body->leaf_capacity, 1, 1, 256);
+
+            ImGui::Checkbox("Group walk", &scene->n_body->group_walk);
+
+            ImGui::Text("Tree rebuild interval:");
+            ImGui::DragInt("##refit_interval", &scene->n_body->refit_interval, 1, 1, 100);
+
+            ImGui::Text("Bound hysteresis:");
+            ImGui::DragFloat("##bound_hysteresis", &scene->n_body->bound_hysteresis, 0.01f, 0.0f, 1.0f);
+
             ImGui::End();
        }
     }
@@ -0,0 +1,233 @@
+/*
+ * @path tests/tests.cpp
+ * @file tests.cpp
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include "simulation/barnes_hut.hpp"
+#include "simulation/direct_sum.hpp"
+#include "simulation/fmm.hpp"
+#include "simulation/kepler.hpp"
+#include "simulation/particle_mesh.hpp"
+#include "simulation/tree_pm.hpp"
+
+// Checks of the simulation alone, without a window. Every test prints what it measured and
+// returns whether it stayed within its bound, the bounds leave a few times the measured values.
+
+// Solver with its bodies and force pass exposed, so that the tests set up the bodies themselves
+template <typename Solver>
+class Probe : public Solver {
+    public:
+        explicit Probe(int bodies_count) : Solver(bodies_count) {
+            this->softening_factor = SOFTENING;
+            this->gravity = 1.0f;
+        }
+
+        static constexpr float SOFTENING = 0.05f;
+
+        BodyStore& get_bodies() {
+            return this->bodies;
+        }
+
+        void calculate() {
+            this->calculate_forces();
+        }
+};
+
+static constexpr int BODY_COUNT = 4096;
+static constexpr unsigned SEED = 12345;
+
+// Plummer sphere of unit scale and mass at rest, cut at ten scale radii, from a fixed seed
+static void place_plummer(BodyStore& bodies) {
+    std::mt19937 gen(SEED);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const size_t count = bodies.size();
+    for (size_t i = 0; i < count; ++i) {
+        const double mass_fraction = 0.001 + 0.99 * uniform(gen);
+        const double radius = std::min(1.0 / std::sqrt(std::pow(mass_fraction, -2.0 / 3.0) - 1.0), 10.0);
+        const double cos_theta = 2.0 * uniform(gen) - 1.0;
+        const double sin_theta = std::sqrt(1.0 - cos_theta * cos_theta);
+        const double phi = 2.0 * M_PI * uniform(gen);
+        bodies.position[0][i] = static_cast<float>(radius * sin_theta * std::cos(phi));
+        bodies.position[1][i] = static_cast<float>(radius * sin_theta * std::sin(phi));
+        bodies.position[2][i] = static_cast<float>(radius * cos_theta);
+        for (int k = 0; k < 3; ++k) {
+            bodies.velocity[k][i] = 0.0f;
+            bodies.acceleration[k][i] = 0.0f;
+        }
+        bodies.mass[i] = 1.0f / static_cast<float>(count);
+    }
+}
+
+template <typename Solver>
+static std::vector<glm::vec3> calculate_accelerations(Probe<Solver>& solver) {
+    BodyStore& bodies = solver.get_bodies();
+    place_plummer(bodies);
+    solver.calculate();
+
+    std::vector<glm::vec3> accelerations(bodies.size());
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        accelerations[i] = glm::vec3(bodies.acceleration[0][i], bodies.acceleration[1][i], bodies.acceleration[2][i]);
+    }
+    return accelerations;
+}
+
+// Root mean square of the force errors relative to the reference forces
+static double rms_error(const std::vector<glm::vec3>& accelerations, const std::vector<glm::vec3>& reference) {
+    double sum = 0.0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        const glm::dvec3 error = glm::dvec3(accelerations[i]) - glm::dvec3(reference[i]);
+        sum += glm::dot(error, error) / glm::dot(glm::dvec3(reference[i]), glm::dvec3(reference[i]));
+    }
+    return std::sqrt(sum / static_cast<double>(reference.size()));
+}
+
+template <typename Solver>
+static bool check_solver(const char* name, const std::vector<glm::vec3>& reference, double bound) {
+    Probe<Solver> solver(BODY_COUNT);
+    const double error = rms_error(calculate_accelerations(solver), reference);
+    const bool passed = error < bound;
+    std::cout << name << ": rms force error " << error << " (bound " << bound << ")" << (passed ? "" : " FAILED") << std::endl;
+    return passed;
+}
+
+// Every solver against direct summation, at the default settings of the solver
+static bool test_forces() {
+    Probe<DirectSum> direct(BODY_COUNT);
+    const std::vector<glm::vec3> reference = calculate_accelerations(direct);
+
+    bool passed = check_solver<BarnesHut>("Barnes-Hut", reference, 1e-2);
+    passed &= check_solver<FMM>("FMM", reference, 1e-2);
+    passed &= check_solver<ParticleMesh>("PM", reference, 0.3);
+    passed &= check_solver<TreePM>("TreePM", reference, 3e-2);
+    return passed;
+}
+
+// Orbits of every kind drifted forward and back again end where they started
+static bool test_kepler() {
+    struct Orbit {
+        const char* name;
+        glm::dvec3 position;
+        glm::dvec3 velocity;
+    };
+    // Circular speed 1 at radius 1 for mu = 1, escape speed sqrt(2)
+    const Orbit orbits[] = {
+        {"circular", glm::dvec3(1.0, 0.0, 0.0), glm::dvec3(0.0, 1.0, 0.0)},
+        {"eccentric", glm::dvec3(1.0, 0.0, 0.0), glm::dvec3(0.0, 0.3, 0.1)},
+        {"parabolic", glm::dvec3(1.0, 0.0, 0.0), glm::dvec3(0.0, std::sqrt(2.0), 0.0)},
+        {"hyperbolic", glm::dvec3(0.0, 1.0, 0.0), glm::dvec3(2.0, 0.5, 0.0)}
+    };
+    const double durations[] = {0.01, 1.0, 25.0};
+    constexpr double mu = 1.0;
+    constexpr double bound = 1e-8;
+
+    bool passed = true;
+    for (const Orbit& orbit : orbits) {
+        double worst = 0.0;
+        for (const double duration : durations) {
+            glm::dvec3 position = orbit.position;
+            glm::dvec3 velocity = orbit.velocity;
+            Kepler::drift(mu, duration, position, velocity);
+            Kepler::drift(mu, -duration, position, velocity);
+            worst = std::max(worst, glm::length(position - orbit.position) / glm::length(orbit.position));
+            worst = std::max(worst, glm::length(velocity - orbit.velocity) / glm::length(orbit.velocity));
+        }
+        const bool orbit_passed = worst < bound;
+        std::cout << "Kepler " << orbit.name << ": round trip error " << worst << " (bound " << bound << ")" << (orbit_passed ? "" : " FAILED") << std::endl;
+        passed &= orbit_passed;
+    }
+    return passed;
+}
+
+// Kinetic and Plummer softened potential energy, in double
+static double total_energy(const BodyStore& bodies, float softening) {
+    const size_t count = bodies.size();
+    double kinetic = 0.0, potential = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        const glm::dvec3 velocity(bodies.get_velocity(i));
+        kinetic += 0.5 * bodies.mass[i] * glm::dot(velocity, velocity);
+        for (size_t j = i + 1; j < count; ++j) {
+            const glm::dvec3 distance = glm::dvec3(bodies.get_position(i)) - glm::dvec3(bodies.get_position(j));
+            potential -= static_cast<double>(bodies.mass[i]) * bodies.mass[j] / std::sqrt(glm::dot(distance, distance) + static_cast<double>(softening) * softening);
+        }
+    }
+    return kinetic + potential;
+}
+
+// Leapfrog steps of a Plummer sphere in virial equilibrium keep the energy to within the bound
+static bool test_leapfrog() {
+    constexpr int body_count = 1024;
+    constexpr int steps = 200;
+    constexpr float delta_time = 0.005f;
+    constexpr double bound = 1e-5;
+
+    Probe<DirectSum> solver(body_count);
+    solver.integrator = NBody::Integrator::LEAPFROG;
+    BodyStore& bodies = solver.get_bodies();
+    place_plummer(bodies);
+    // The bodies start at rest
+    const double potential = total_energy(bodies, Probe<DirectSum>::SOFTENING);
+
+    // Random velocities scaled to twice the kinetic energy balancing the potential energy
+    std::mt19937 gen(SEED);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        for (int k = 0; k < 3; ++k) {
+            bodies.velocity[k][i] = normal(gen);
+        }
+    }
+    double kinetic = 0.0;
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        const glm::dvec3 velocity(bodies.get_velocity(i));
+        kinetic += 0.5 * bodies.mass[i] * glm::dot(velocity, velocity);
+    }
+    const auto scale = static_cast<float>(std::sqrt(-0.5 * potential / kinetic));
+    for (auto& component : bodies.velocity) {
+        for (float& velocity : component) {
+            velocity *= scale;
+        }
+    }
+
+    const double initial = total_energy(bodies, Probe<DirectSum>::SOFTENING);
+    for (int step = 0; step < steps; ++step) {
+        solver.update(delta_time);
+    }
+    const double drift = std::abs((total_energy(bodies, Probe<DirectSum>::SOFTENING) - initial) / initial);
+
+    const bool passed = drift < bound;
+    std::cout << "Leapfrog: relative energy drift " << drift << " over " << steps << " steps (bound " << bound << ")" << (passed ? "" : " FAILED") << std::endl;
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    struct Test {
+        const char* name;
+        bool (*run)();
+    };
+    const Test tests[] = {
+        {"forces", test_forces},
+        {"kepler", test_kepler},
+        {"leapfrog", test_leapfrog}
+    };
+
+    // Runs the named test, or all of them without a name
+    bool passed = true;
+    bool found = argc < 2;
+    for (const Test& test : tests) {
+        if (argc < 2 || std::strcmp(argv[1], test.name) == 0) {
+            passed &= test.run();
+            found = true;
+        }
+    }
+    if (!found) {
+        std::cerr << "Unknown test: " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}